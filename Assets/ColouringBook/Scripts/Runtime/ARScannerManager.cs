@@ -24,9 +24,9 @@ namespace Felina.ARColoringBook
     public class ARScannerManager : MonoBehaviour
     {
 #if UNITY_IOS && !UNITY_EDITOR
-        [DllImport("__Internal")] private static unsafe extern void ComputeTransformMatrix( float a, float b, void* c, void* d );
+        [DllImport("__Internal")] [return: MarshalAs( UnmanagedType.I1 )] private static unsafe extern bool ProjectTargetTransform( float3 a, quaternion b, float2 c, void* d, float e, float f, float g, float h, void* i, void* j );
 #else        
-        [DllImport( "Felina" )] private static unsafe extern void ComputeTransformMatrix( float a, float b, void* c, void* d );
+        [DllImport( "Felina" )] [return: MarshalAs( UnmanagedType.I1 )] private static unsafe extern bool ProjectTargetTransform( float3 a, quaternion b, float2 c, void* d, float e, float f, float g, float h, void* i, void* j );
 #endif
         public static ARScannerManager Instance { get; private set; }
         private Camera _arCamera;
@@ -40,7 +40,6 @@ namespace Felina.ARColoringBook
 
         [SerializeField] private Material _unwarpMaterial;
 
-        private NativeArray<float2> _nativeScreenPoints;
         private NativeArray<float4x4> _nativeResultMatrix;
 
         // Cache material property IDs for better performance
@@ -91,13 +90,11 @@ namespace Felina.ARColoringBook
                 _lastCamRot = _arCamera.transform.rotation;
             }
 
-            _nativeScreenPoints = new NativeArray<float2>( 4, Allocator.Persistent );
             _nativeResultMatrix = new NativeArray<float4x4>( 1, Allocator.Persistent );
         }
 
         void OnDestroy()
         {
-            if ( _nativeScreenPoints.IsCreated ) _nativeScreenPoints.Dispose();
             if ( _nativeResultMatrix.IsCreated ) _nativeResultMatrix.Dispose();
             _cancellationToken?.Cancel();
             _cancellationToken?.Dispose();
@@ -116,30 +113,19 @@ namespace Felina.ARColoringBook
         {
             ARFoundationBridge.Instance.UpdateCameraRT();
 
-            if ( !_nativeScreenPoints.IsCreated || !_nativeResultMatrix.IsCreated ) return;
+            if ( !_nativeResultMatrix.IsCreated ) return;
 
-            var size = _target.Size;
-            var hx = size.x * 0.5f;
-            var hy = size.y * 0.5f;
             var t = _target.Transform;
+            t.GetPositionAndRotation( out var tPos, out var tRot );
 
-            // Cache transform using Unity.Mathematics types for better performance
-            var tPos = ( float3 ) t.position;
-            var tRight = ( float3 ) t.right;
-            var tForward = ( float3 ) t.forward;
-
-            // Calculate corner positions using Unity.Mathematics
-            var halfExtentX = tRight * hx;
-            var halfExtentZ = tForward * hy;
-
-            _nativeScreenPoints[ 0 ] = ToScreen( tPos - halfExtentX - halfExtentZ );
-            _nativeScreenPoints[ 1 ] = ToScreen( tPos + halfExtentX - halfExtentZ );
-            _nativeScreenPoints[ 2 ] = ToScreen( tPos + halfExtentX + halfExtentZ );
-            _nativeScreenPoints[ 3 ] = ToScreen( tPos - halfExtentX + halfExtentZ );
+            // Corners are projected and solved natively (no per-corner WorldToScreenPoint round trips)
+            float4x4 viewProjection = _arCamera.projectionMatrix * _arCamera.worldToCameraMatrix;
 
+            // Corners land in camera pixels (as WorldToScreenPoint) and are normalised by the screen resolution, as before
             var resolution = Screen.currentResolution;
 
-            ComputeTransformMatrix( resolution.width, resolution.height, _nativeScreenPoints.GetUnsafePtr(), _nativeResultMatrix.GetUnsafePtr() );
+            if ( !ProjectTargetTransform( tPos, tRot, _target.Size, &viewProjection, _arCamera.pixelWidth, _arCamera.pixelHeight, resolution.width, resolution.height, null, _nativeResultMatrix.GetUnsafePtr() ) )
+                return; // Page corner behind the camera
 
             var H = _nativeResultMatrix[ 0 ];
 
@@ -170,12 +156,6 @@ namespace Felina.ARColoringBook
             OnTextureCaptured?.Invoke();
         }
 
-        private float2 ToScreen( float3 worldPos )
-        {
-            var s = _arCamera.WorldToScreenPoint( worldPos );
-            return new float2( s.x, s.y );
-        }
-
         private void OnTargetAdded( ScanTarget incomingTarget )
         {
             _target = incomingTarget;
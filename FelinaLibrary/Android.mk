@@ -2,7 +2,17 @@ LOCAL_PATH := $(call my-dir)
 include $(CLEAR_VARS)
 
 LOCAL_MODULE    := Felina
-LOCAL_SRC_FILES := src/Felina.cpp
+LOCAL_SRC_FILES := src/Felina.cpp \
+                   src/FelinaAlign.cpp \
+                   src/FelinaGutter.cpp \
+                   src/FelinaHalf.cpp \
+                   src/FelinaIntegral.cpp \
+                   src/FelinaPalette.cpp \
+                   src/FelinaPaper.cpp \
+                   src/FelinaParallel.cpp \
+                   src/FelinaReference.cpp \
+                   src/FelinaRegions.cpp \
+                   src/FelinaWarp.cpp
 
 APP_ABI := arm64-v8a
 APP_PLATFORM := android-21
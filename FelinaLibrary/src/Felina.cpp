@@ -7,13 +7,11 @@
 #include <stdlib.h> // malloc/free
 #include <string>
 #include <sstream>
+#include <algorithm> // std::sort
+#include <chrono>    // latency budgets
 
-// Export macro
-#if defined(_WIN32)
-#define EXPORT_API __declspec(dllexport) 
-#else
-#define EXPORT_API __attribute__((visibility("default")))
-#endif
+// Shared types, SIMD helpers and homography helpers
+#include "FelinaCommon.h"
 
 // XOR obfuscation helper
 void XorString(char* buffer, const char* source, int len, char key) {
@@ -147,17 +145,6 @@ const long long CHECK_INTERVAL_TICKS = 25920000000000;
 
 extern "C" {
 
-	// --- STRUCTS (Matches Unity.Mathematics) ---
-	struct Float2 { float x, y; };
-	struct Float3 { float x, y, z; };
-	struct Float4 { float x, y, z, w; }; // Quaternion
-	struct Float4x4 {
-		float c0x, c0y, c0z, c0w;
-		float c1x, c1y, c1z, c1w;
-		float c2x, c2y, c2z, c2w;
-		float c3x, c3y, c3z, c3w;
-	};
-
 	// --- NEW: Internal Helper for Aspect Ratio (Hidden logic) ---
 	static inline void ComputeUVs(Float2* uvs) 
 	{
@@ -306,50 +293,17 @@ extern "C" {
 
 		if (uScale == 0.0f || vScale == 0.0f) {
 			// Degenerate source -> return identity
-			result->c0x = 1.0f; result->c0y = 0.0f; result->c0z = 0.0f; result->c0w = 0.0f;
-			result->c1x = 0.0f; result->c1y = 1.0f; result->c1z = 0.0f; result->c1w = 0.0f;
-			result->c2x = 0.0f; result->c2y = 0.0f; result->c2z = 1.0f; result->c2w = 0.0f;
-			result->c3x = 0.0f; result->c3y = 0.0f; result->c3z = 0.0f; result->c3w = 1.0f;
+			SetIdentity(result);
 			return;
 		}
 
-		// Destination quad points (corresponding to unit square corners)
-		// p0 = dst(0,0), p1 = dst(1,0), p2 = dst(1,1), p3 = dst(0,1)
-		float x0 = dst[0].x, y0 = dst[0].y;
-		float x1 = dst[1].x, y1 = dst[1].y;
-		float x2 = dst[2].x, y2 = dst[2].y;
-		float x3 = dst[3].x, y3 = dst[3].y;
-
-		// Compute differences
-		float dx1 = x1 - x2;
-		float dx2 = x3 - x2;
-		float dx3 = x0 - x1 + x2 - x3;
-		float dy1 = y1 - y2;
-		float dy2 = y3 - y2;
-		float dy3 = y0 - y1 + y2 - y3;
-
-		const float EPS = 1e-9f;
-		float h20 = 0.0f, h21 = 0.0f;
-		float den = dx1 * dy2 - dy1 * dx2;
-		if (fabsf(den) < EPS) {
-			// Affine case (or degenerate) - build affine homography
-			h20 = 0.0f; h21 = 0.0f;
-		}
-		else {
-			h20 = (dx3 * dy2 - dy3 * dx2) / den;
-			h21 = (dx1 * dy3 - dy1 * dx3) / den;
-		}
-
-		// Compose full homography H mapping unit-square to quad
-		float h00 = x1 - x0 + h20 * x1;
-		float h01 = x3 - x0 + h21 * x3;
-		float h02 = x0;
-
-		float h10 = y1 - y0 + h20 * y1;
-		float h11 = y3 - y0 + h21 * y3;
-		float h12 = y0;
+		// Closed-form unit square -> destination quad
+		float h[9];
+		SquareToQuad(dst, h);
 
-		float h22 = 1.0f;
+		const float h00 = h[0], h01 = h[1], h02 = h[2];
+		const float h10 = h[3], h11 = h[4], h12 = h[5];
+		const float h20 = h[6], h21 = h[7], h22 = h[8];
 
 		// Compose with transform T that maps src rect -> unit square: H_final = H_unit * T
 		const float invU = 1.0f / uScale;
@@ -373,5 +327,866 @@ extern "C" {
 		result->c2x = c02; result->c2y = c12; result->c2z = c22; result->c2w = 0.0f;
 		result->c3x = 0.0f; result->c3y = 0.0f; result->c3z = 0.0f; result->c3w = 1.0f;
 	}
+
+	// --- STEP 5: QUAD-TO-QUAD HOMOGRAPHY ---
+	// Maps an arbitrary source quad onto an arbitrary destination quad:
+	//   H = SquareToQuad(dst) * QuadToSquare(src)
+	// Corners are ordered like ComputeUVs: (0,0), (1,0), (1,1), (0,1) of the source region.
+	// Coordinates are used as given (no screen normalisation), so page sub-regions,
+	// crops and spreads can be unwarped with a single precomputed matrix.
+	// 'inverse' is optional (may be null) and receives the dst -> src mapping.
+	// Returns false and writes identity for degenerate quads.
+	EXPORT_API bool ComputeQuadToQuadMatrix(
+		Float2* srcPoints,              // 4 source corners
+		Float2* dstPoints,              // 4 destination corners
+		Float4x4* result,               // Output src -> dst
+		Float4x4* inverse               // Output dst -> src (optional)
+	) {
+		float srcToSquare[9];
+		float squareToDst[9];
+		float h[9];
+
+		if (!QuadToSquare(srcPoints, srcToSquare)) {
+			SetIdentity(result);
+			if (inverse) SetIdentity(inverse);
+			return false;
+		}
+
+		SquareToQuad(dstPoints, squareToDst);
+		Mat3Mul(squareToDst, srcToSquare, h);
+		Mat3Normalize(h);
+
+		float inv[9];
+		if (!Mat3Inverse(h, inv)) {
+			SetIdentity(result);
+			if (inverse) SetIdentity(inverse);
+			return false;
+		}
+
+		PackMatrix(h, result);
+		if (inverse) {
+			Mat3Normalize(inv);
+			PackMatrix(inv, inverse);
+		}
+		return true;
+	}
+
+	// Analytic inverse of a homography packed by ComputeTransformMatrix / ComputeQuadToQuadMatrix.
+	// Only the upper-left 3x3 is used. Returns false and writes identity if singular.
+	EXPORT_API bool InvertTransformMatrix(
+		Float4x4* matrix,               // Input homography
+		Float4x4* result                // Output inverse
+	) {
+		float h[9], inv[9];
+		UnpackMatrix(matrix, h);
+
+		if (!Mat3Inverse(h, inv)) {
+			SetIdentity(result);
+			return false;
+		}
+
+		PackMatrix(inv, result);
+		return true;
+	}
+
+	// --- STEP 6: BATCHED HOMOGRAPHY (SoA) ---
+	// One interop call for every tracked target in a frame.
+	// 'quads' holds 8 planes of 'count' floats each (structure-of-arrays):
+	//   x0[count], y0[count], x1[count], y1[count], x2[count], y2[count], x3[count], y3[count]
+	// Points are raw pixels like ComputeTransformMatrix; results[i] matches
+	// ComputeTransformMatrix for quad i (same operation order, true divides).
+	// Four quads are solved per iteration with SSE2 / NEON, the tail falls back to scalar.
+	EXPORT_API void ComputeTransformMatrixBatch(
+		float screenW, float screenH,   // Screen Resolution
+		float* quads,                   // 8 * count floats, SoA planes (raw pixels)
+		int count,                      // Number of quads
+		Float4x4* results               // Output Matrices (count)
+	) {
+		if (count <= 0 || !quads || !results) return;
+
+		const float* px0 = quads;
+		const float* py0 = quads + count;
+		const float* px1 = quads + count * 2;
+		const float* py1 = quads + count * 3;
+		const float* px2 = quads + count * 4;
+		const float* py2 = quads + count * 5;
+		const float* px3 = quads + count * 6;
+		const float* py3 = quads + count * 7;
+
+		int i = 0;
+
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+		// ComputeUVs is the unit square, so the composition with T is the identity
+		// and the packed matrix is the square -> quad homography itself.
+		const Vec4f invW = V4Set(1.0f / screenW);
+		const Vec4f invH = V4Set(1.0f / screenH);
+		const Vec4f eps = V4Set(1e-9f);
+		const Vec4f zero = V4Set(0.0f);
+		const Vec4f one = V4Set(1.0f);
+
+		for (; i + 4 <= count; i += 4) {
+			// 1. Normalize
+			const Vec4f x0 = V4Mul(V4Load(px0 + i), invW), y0 = V4Mul(V4Load(py0 + i), invH);
+			const Vec4f x1 = V4Mul(V4Load(px1 + i), invW), y1 = V4Mul(V4Load(py1 + i), invH);
+			const Vec4f x2 = V4Mul(V4Load(px2 + i), invW), y2 = V4Mul(V4Load(py2 + i), invH);
+			const Vec4f x3 = V4Mul(V4Load(px3 + i), invW), y3 = V4Mul(V4Load(py3 + i), invH);
+
+			// 2. Differences (same order as SquareToQuad)
+			const Vec4f dx1 = V4Sub(x1, x2);
+			const Vec4f dx2 = V4Sub(x3, x2);
+			const Vec4f dx3 = V4Sub(V4Add(V4Sub(x0, x1), x2), x3);
+			const Vec4f dy1 = V4Sub(y1, y2);
+			const Vec4f dy2 = V4Sub(y3, y2);
+			const Vec4f dy3 = V4Sub(V4Add(V4Sub(y0, y1), y2), y3);
+
+			// 3. Perspective terms (zeroed where the quad is affine / degenerate)
+			const Vec4f den = V4Sub(V4Mul(dx1, dy2), V4Mul(dy1, dx2));
+			const Vec4f h20 = V4SelectAbsGE(den, eps, V4Div(V4Sub(V4Mul(dx3, dy2), V4Mul(dy3, dx2)), den));
+			const Vec4f h21 = V4SelectAbsGE(den, eps, V4Div(V4Sub(V4Mul(dx1, dy3), V4Mul(dy1, dx3)), den));
+
+			// 4. Remaining terms
+			const Vec4f h00 = V4Add(V4Sub(x1, x0), V4Mul(h20, x1));
+			const Vec4f h01 = V4Add(V4Sub(x3, x0), V4Mul(h21, x3));
+			const Vec4f h10 = V4Add(V4Sub(y1, y0), V4Mul(h20, y1));
+			const Vec4f h11 = V4Add(V4Sub(y3, y0), V4Mul(h21, y3));
+
+			// 5. Pack 4 column-major Float4x4 (transpose lanes -> matrices)
+			float* out = (float*)(results + i);
+			V4StoreColumn(out + 0, h00, h10, h20, zero);
+			V4StoreColumn(out + 4, h01, h11, h21, zero);
+			V4StoreColumn(out + 8, x0, y0, one, zero);
+			V4StoreColumn(out + 12, zero, zero, zero, one);
+		}
+#endif
+
+		// Scalar tail (or whole batch when no SIMD is available)
+		for (; i < count; i++) {
+			Float2 pts[4] = {
+				{ px0[i], py0[i] }, { px1[i], py1[i] },
+				{ px2[i], py2[i] }, { px3[i], py3[i] }
+			};
+			ComputeTransformMatrix(screenW, screenH, pts, results + i);
+		}
+	}
+
+	// --- STEP 7: LEAST-SQUARES HOMOGRAPHY (N >= 4) ---
+	// Hartley-normalised DLT: both point sets are moved to their centroid and scaled
+	// to a mean distance of sqrt(2), the 2N x 9 system is reduced to the 9x9 normal
+	// matrix A^T A and H is its eigenvector with the smallest eigenvalue.
+	// Extra points (edge midpoints, features) average out per-corner jitter.
+
+	struct HomographyFit {
+		float rmsError;                 // RMS forward reprojection error (dst units)
+		float maxError;                 // Worst forward reprojection error (dst units)
+		float conditionNumber;          // sigma_max / sigma_8 of the normalised system (large = ill-posed)
+		float nullity;                  // sigma_9 / sigma_8 (0 = exact fit, ~1 = no distinct solution)
+		int pointCount;
+	};
+
+	// Similarity T so that T * p has zero mean and mean distance sqrt(2)
+	static inline bool NormalizePoints(const Float2* p, int count, double* t) {
+		double cx = 0.0, cy = 0.0;
+		for (int i = 0; i < count; i++) { cx += p[i].x; cy += p[i].y; }
+		cx /= count; cy /= count;
+
+		double meanDist = 0.0;
+		for (int i = 0; i < count; i++) {
+			const double dx = p[i].x - cx, dy = p[i].y - cy;
+			meanDist += sqrt(dx * dx + dy * dy);
+		}
+		meanDist /= count;
+		if (meanDist < 1e-12) return false;
+
+		const double s = 1.4142135623730951 / meanDist;
+		t[0] = s;   t[1] = 0.0; t[2] = -s * cx;
+		t[3] = 0.0; t[4] = s;   t[5] = -s * cy;
+		t[6] = 0.0; t[7] = 0.0; t[8] = 1.0;
+		return true;
+	}
+
+	// Cyclic Jacobi eigen-decomposition of a symmetric 9x9 matrix (destroys 'a').
+	// Eigenvalues in w, eigenvectors in the columns of v (row-major).
+	static void JacobiEigen9(double* a, double* w, double* v) {
+		const int n = 9;
+		for (int i = 0; i < n * n; i++) v[i] = 0.0;
+		for (int i = 0; i < n; i++) v[i * n + i] = 1.0;
+
+		for (int sweep = 0; sweep < 50; sweep++) {
+			double off = 0.0;
+			for (int p = 0; p < n; p++)
+				for (int q = p + 1; q < n; q++) off += a[p * n + q] * a[p * n + q];
+			if (off < 1e-30) break;
+
+			for (int p = 0; p < n; p++) {
+				for (int q = p + 1; q < n; q++) {
+					const double apq = a[p * n + q];
+					if (fabs(apq) < 1e-300) continue;
+
+					const double theta = (a[q * n + q] - a[p * n + p]) / (2.0 * apq);
+					const double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+					const double c = 1.0 / sqrt(t * t + 1.0);
+					const double sn = t * c;
+
+					for (int k = 0; k < n; k++) {
+						const double akp = a[k * n + p], akq = a[k * n + q];
+						a[k * n + p] = c * akp - sn * akq;
+						a[k * n + q] = sn * akp + c * akq;
+					}
+					for (int k = 0; k < n; k++) {
+						const double apk = a[p * n + k], aqk = a[q * n + k];
+						a[p * n + k] = c * apk - sn * aqk;
+						a[q * n + k] = sn * apk + c * aqk;
+					}
+					for (int k = 0; k < n; k++) {
+						const double vkp = v[k * n + p], vkq = v[k * n + q];
+						v[k * n + p] = c * vkp - sn * vkq;
+						v[k * n + q] = sn * vkp + c * vkq;
+					}
+				}
+			}
+		}
+		for (int i = 0; i < n; i++) w[i] = a[i * n + i];
+	}
+
+	// Smallest homogeneous w of a valid projection: points at or behind the horizon never count
+	static const float REPROJECTION_MIN_W = 1e-8f;
+
+	// Forward reprojection error of src -> dst through row-major h (1e30 behind the horizon)
+	static inline float ReprojectionErrorSq(const float* h, Float2 s, Float2 d) {
+		const float w = h[6] * s.x + h[7] * s.y + h[8];
+		if (!(w > REPROJECTION_MIN_W)) return 1e30f;
+		const float invW = 1.0f / w;
+		const float ex = (h[0] * s.x + h[1] * s.y + h[2]) * invW - d.x;
+		const float ey = (h[3] * s.x + h[4] * s.y + h[5]) * invW - d.y;
+		return ex * ex + ey * ey;
+	}
+
+	// Internal DLT solve. Writes a row-major h (h22 == 1) and optional fit statistics.
+	static bool SolveHomographyDLT(const Float2* src, const Float2* dst, int count, float* h, HomographyFit* fit) {
+		if (count < 4) return false;
+
+		double ts[9], td[9];
+		if (!NormalizePoints(src, count, ts) || !NormalizePoints(dst, count, td)) return false;
+
+		// 1. Accumulate A^T A (upper triangle) without materialising A
+		double ata[81] = { 0.0 };
+		for (int i = 0; i < count; i++) {
+			const double x = ts[0] * src[i].x + ts[2], y = ts[4] * src[i].y + ts[5];
+			const double u = td[0] * dst[i].x + td[2], v = td[4] * dst[i].y + td[5];
+
+			const double r1[9] = { -x, -y, -1.0, 0.0, 0.0, 0.0, u * x, u * y, u };
+			const double r2[9] = { 0.0, 0.0, 0.0, -x, -y, -1.0, v * x, v * y, v };
+			for (int r = 0; r < 9; r++)
+				for (int c = r; c < 9; c++) ata[r * 9 + c] += r1[r] * r1[c] + r2[r] * r2[c];
+		}
+		for (int r = 0; r < 9; r++)
+			for (int c = 0; c < r; c++) ata[r * 9 + c] = ata[c * 9 + r];
+
+		// 2. Smallest eigenvector = normalised homography
+		double w[9], vec[81];
+		JacobiEigen9(ata, w, vec);
+
+		int order[9];
+		for (int i = 0; i < 9; i++) order[i] = i;
+		for (int i = 1; i < 9; i++) {
+			const int k = order[i];
+			int j = i - 1;
+			while (j >= 0 && w[order[j]] > w[k]) { order[j + 1] = order[j]; j--; }
+			order[j + 1] = k;
+		}
+
+		double hn[9];
+		for (int i = 0; i < 9; i++) hn[i] = vec[i * 9 + order[0]];
+
+		// 3. Denormalise: H = Td^-1 * Hn * Ts
+		const double invS = 1.0 / td[0];
+		const double tdInv[9] = {
+			invS, 0.0, -td[2] * invS,
+			0.0, invS, -td[5] * invS,
+			0.0, 0.0, 1.0
+		};
+		double tmp[9], hd[9];
+		for (int r = 0; r < 3; r++)
+			for (int c = 0; c < 3; c++)
+				tmp[r * 3 + c] = hn[r * 3 + 0] * ts[0 * 3 + c] + hn[r * 3 + 1] * ts[1 * 3 + c] + hn[r * 3 + 2] * ts[2 * 3 + c];
+		for (int r = 0; r < 3; r++)
+			for (int c = 0; c < 3; c++)
+				hd[r * 3 + c] = tdInv[r * 3 + 0] * tmp[0 * 3 + c] + tdInv[r * 3 + 1] * tmp[1 * 3 + c] + tdInv[r * 3 + 2] * tmp[2 * 3 + c];
+
+		if (fabs(hd[8]) < 1e-12) return false;
+		const double invH22 = 1.0 / hd[8];
+		for (int i = 0; i < 9; i++) h[i] = (float)(hd[i] * invH22);
+		h[8] = 1.0f;
+
+		// 4. Statistics
+		if (fit) {
+			double sumSq = 0.0;
+			float maxSq = 0.0f;
+			for (int i = 0; i < count; i++) {
+				const float e = ReprojectionErrorSq(h, src[i], dst[i]);
+				sumSq += e;
+				if (e > maxSq) maxSq = e;
+			}
+			const double l9 = w[order[0]] > 0.0 ? w[order[0]] : 0.0;
+			const double l8 = w[order[1]] > 0.0 ? w[order[1]] : 0.0;
+			const double l1 = w[order[8]] > 0.0 ? w[order[8]] : 0.0;
+
+			fit->rmsError = (float)sqrt(sumSq / count);
+			fit->maxError = sqrtf(maxSq);
+			fit->conditionNumber = l8 > 0.0 ? (float)sqrt(l1 / l8) : 1e30f;
+			fit->nullity = l8 > 0.0 ? (float)sqrt(l9 / l8) : 1.0f;
+			fit->pointCount = count;
+		}
+		return true;
+	}
+
+	// Least-squares homography from N >= 4 correspondences (src -> dst, coordinates as given).
+	// 'fit' is optional. Returns false and writes identity if the points are degenerate.
+	EXPORT_API bool ComputeHomographyLeastSquares(
+		Float2* srcPoints,              // N source points
+		Float2* dstPoints,              // N destination points
+		int count,                      // N (>= 4)
+		Float4x4* result,               // Output src -> dst
+		HomographyFit* fit              // Output statistics (optional)
+	) {
+		float h[9];
+		if (!srcPoints || !dstPoints || !SolveHomographyDLT(srcPoints, dstPoints, count, h, fit)) {
+			SetIdentity(result);
+			if (fit) {
+				fit->rmsError = 0.0f; fit->maxError = 0.0f;
+				fit->conditionNumber = 1e30f; fit->nullity = 1.0f;
+				fit->pointCount = count;
+			}
+			return false;
+		}
+
+		PackMatrix(h, result);
+		return true;
+	}
+
+	// --- STEP 8: ROBUST HOMOGRAPHY (PROSAC) ---
+	// Rejects outliers from hands covering the page or bent paper.
+	// - PROSAC: points are drawn progressively from the best-scored ones first
+	// - minimal 4-point hypotheses come from the closed-form quad-to-quad solve,
+	//   generated in batches into a preallocated hypothesis buffer
+	// - inliers are counted 4 points at a time (SIMD, division-free test)
+	// - adaptive early termination from the current inlier ratio, plus a hard
+	//   latency budget so the call fits inside a frame
+	// - the best hypothesis is refit on its inliers with the least-squares solver
+	// The RobustFit output is declared in FelinaCommon.h.
+
+	static const int ROBUST_HYPOTHESIS_BATCH = 16;
+
+	// Preallocated working memory, created once and reused every frame
+	struct HomographyEstimator {
+		int capacity;
+		float* sx; float* sy;           // SoA source points
+		float* dx; float* dy;           // SoA destination points
+		int* order;                     // PROSAC order (best first)
+		Float2* inSrc; Float2* inDst;   // Inlier gather for the refit
+		float hypotheses[ROBUST_HYPOTHESIS_BATCH * 9];
+		unsigned int rng;
+	};
+
+	static inline unsigned int NextRandom(unsigned int* state) {
+		unsigned int x = *state;
+		x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+		*state = x;
+		return x;
+	}
+
+	// Number of points within 'thresholdSq' of their projection (SoA layout)
+	static int CountInliers(const HomographyEstimator* est, int count, const float* h, float thresholdSq) {
+		int inliers = 0;
+		int i = 0;
+
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+		const Vec4f h0 = V4Set(h[0]), h1 = V4Set(h[1]), h2 = V4Set(h[2]);
+		const Vec4f h3 = V4Set(h[3]), h4 = V4Set(h[4]), h5 = V4Set(h[5]);
+		const Vec4f h6 = V4Set(h[6]), h7 = V4Set(h[7]), h8 = V4Set(h[8]);
+		const Vec4f t2 = V4Set(thresholdSq);
+		const Vec4f wMin = V4Set(REPROJECTION_MIN_W);
+
+		for (; i + 4 <= count; i += 4) {
+			const Vec4f x = V4Load(est->sx + i), y = V4Load(est->sy + i);
+			const Vec4f u = V4Load(est->dx + i), v = V4Load(est->dy + i);
+
+			const Vec4f w = V4Add(V4Add(V4Mul(h6, x), V4Mul(h7, y)), h8);
+			// |p/w - d|^2 < t^2  <=>  |p - d*w|^2 < t^2 * w^2   (for w > 0)
+			const Vec4f ex = V4Sub(V4Add(V4Add(V4Mul(h0, x), V4Mul(h1, y)), h2), V4Mul(u, w));
+			const Vec4f ey = V4Sub(V4Add(V4Add(V4Mul(h3, x), V4Mul(h4, y)), h5), V4Mul(v, w));
+			const Vec4f err = V4Add(V4Mul(ex, ex), V4Mul(ey, ey));
+
+			const Vec4f mask = V4And(V4CmpLt(err, V4Mul(t2, V4Mul(w, w))), V4CmpGt(w, wMin));
+			inliers += V4CountMask(mask);
+		}
+#endif
+
+		for (; i < count; i++) {
+			const float w = h[6] * est->sx[i] + h[7] * est->sy[i] + h[8];
+			const float ex = h[0] * est->sx[i] + h[1] * est->sy[i] + h[2] - est->dx[i] * w;
+			const float ey = h[3] * est->sx[i] + h[4] * est->sy[i] + h[5] - est->dy[i] * w;
+			if (w > REPROJECTION_MIN_W && ex * ex + ey * ey < thresholdSq * w * w) inliers++;
+		}
+		return inliers;
+	}
+
+	EXPORT_API void* CreateHomographyEstimator(int maxPoints) {
+		if (maxPoints < 4) return nullptr;
+
+		HomographyEstimator* est = (HomographyEstimator*)malloc(sizeof(HomographyEstimator));
+		if (!est) return nullptr;
+		memset(est, 0, sizeof(HomographyEstimator));
+
+		est->capacity = maxPoints;
+		est->sx = (float*)malloc(sizeof(float) * maxPoints * 4);
+		est->order = (int*)malloc(sizeof(int) * maxPoints);
+		est->inSrc = (Float2*)malloc(sizeof(Float2) * maxPoints * 2);
+		est->rng = 0x9E3779B9u;
+
+		if (!est->sx || !est->order || !est->inSrc) {
+			free(est->sx); free(est->order); free(est->inSrc); free(est);
+			return nullptr;
+		}
+		est->sy = est->sx + maxPoints;
+		est->dx = est->sx + maxPoints * 2;
+		est->dy = est->sx + maxPoints * 3;
+		est->inDst = est->inSrc + maxPoints;
+		return est;
+	}
+
+	EXPORT_API void DestroyHomographyEstimator(void* estimator) {
+		HomographyEstimator* est = (HomographyEstimator*)estimator;
+		if (!est) return;
+		free(est->sx);
+		free(est->order);
+		free(est->inSrc);
+		free(est);
+	}
+
+	// src/dst: correspondences (coordinates as given). scores: optional per-point
+	// confidence (higher = better) used for the PROSAC order; null = already sorted best-first.
+	// threshold: inlier distance in dst units. budgetMs <= 0 disables the time limit.
+	// inlierMask (optional, count bytes) receives 1 for inliers of the returned model.
+	EXPORT_API bool EstimateHomographyRobust(
+		void* estimator,
+		Float2* srcPoints, Float2* dstPoints, float* scores, int count,
+		float threshold, float confidence, int maxIterations, float budgetMs,
+		Float4x4* result,
+		unsigned char* inlierMask,
+		RobustFit* fit
+	) {
+		typedef std::chrono::steady_clock Clock;
+		const Clock::time_point start = Clock::now();
+
+		HomographyEstimator* est = (HomographyEstimator*)estimator;
+		if (fit) memset(fit, 0, sizeof(RobustFit));
+		if (!result) return false;
+		SetIdentity(result);
+		if (!est || !srcPoints || !dstPoints || count < 4 || count > est->capacity) return false;
+
+		// 1. PROSAC order + SoA copy
+		for (int i = 0; i < count; i++) est->order[i] = i;
+		if (scores) {
+			std::sort(est->order, est->order + count, [scores](int a, int b) { return scores[a] > scores[b]; });
+		}
+		for (int i = 0; i < count; i++) {
+			const int k = est->order[i];
+			est->sx[i] = srcPoints[k].x; est->sy[i] = srcPoints[k].y;
+			est->dx[i] = dstPoints[k].x; est->dy[i] = dstPoints[k].y;
+		}
+
+		const float thresholdSq = threshold * threshold;
+		if (confidence <= 0.0f || confidence >= 1.0f) confidence = 0.995f;
+		if (maxIterations <= 0) maxIterations = 2000;
+		const double logConf = log(1.0 - confidence);
+
+		// 2. PROSAC growth schedule (Chum & Matas 2005), T_N = maxIterations
+		double tn = maxIterations;
+		for (int i = 0; i < 4; i++) tn *= (double)(4 - i) / (double)(count - i);
+		int n = 4;
+		int tnPrime = 1;
+
+		float bestH[9];
+		int bestInliers = -1;
+		int iterLimit = maxIterations;
+		int iterations = 0;
+		bool outOfTime = false;
+
+		while (iterations < iterLimit && !outOfTime) {
+			// 2a. Fill the hypothesis buffer
+			int generated = 0;
+			for (int attempt = 0; generated < ROBUST_HYPOTHESIS_BATCH && attempt < ROBUST_HYPOTHESIS_BATCH * 4; attempt++) {
+				const int t = iterations + generated + 1;
+				if (t > tnPrime && n < count) {
+					const double tn1 = tn * (n + 1) / (double)(n + 1 - 4);
+					n++;
+					tnPrime += (int)ceil(tn1 - tn);
+					tn = tn1;
+				}
+
+				// Sample: the newest point + 3 from the rest, or 4 from the current subset
+				int idx[4];
+				int picked = 0;
+				int pool = n;
+				if (tnPrime >= t) { idx[picked++] = n - 1; pool = n - 1; }
+				while (picked < 4) {
+					const int k = (int)(NextRandom(&est->rng) % (unsigned int)pool);
+					bool dup = false;
+					for (int j = 0; j < picked; j++) dup |= (idx[j] == k);
+					if (!dup) idx[picked++] = k;
+				}
+
+				Float2 qs[4], qd[4];
+				for (int j = 0; j < 4; j++) {
+					qs[j].x = est->sx[idx[j]]; qs[j].y = est->sy[idx[j]];
+					qd[j].x = est->dx[idx[j]]; qd[j].y = est->dy[idx[j]];
+				}
+
+				float srcToSquare[9], squareToDst[9];
+				if (!QuadToSquare(qs, srcToSquare)) continue;  // collinear sample
+				SquareToQuad(qd, squareToDst);
+
+				float* h = est->hypotheses + generated * 9;
+				Mat3Mul(squareToDst, srcToSquare, h);
+				Mat3Normalize(h);
+				generated++;
+			}
+			if (generated == 0) break;
+
+			// 2b. Score the batch
+			for (int k = 0; k < generated; k++) {
+				const float* h = est->hypotheses + k * 9;
+				const int inliers = CountInliers(est, count, h, thresholdSq);
+				if (inliers > bestInliers) {
+					bestInliers = inliers;
+					memcpy(bestH, h, sizeof(bestH));
+
+					// 2c. Adaptive termination
+					const double w = (double)inliers / count;
+					const double pGood = w * w * w * w;
+					if (pGood >= 1.0 - 1e-12) iterLimit = iterations + k + 1;
+					else if (pGood > 1e-12) {
+						const double needed = logConf / log(1.0 - pGood);
+						if (needed < iterLimit) iterLimit = (int)ceil(needed);
+					}
+				}
+			}
+			iterations += generated;
+
+			if (budgetMs > 0.0f) {
+				const float elapsed = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+				outOfTime = elapsed >= budgetMs;
+			}
+		}
+
+		if (bestInliers < 4) {
+			if (fit) {
+				fit->iterations = iterations;
+				fit->elapsedMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+			}
+			return false;
+		}
+
+		// 3. Refit on the inliers (least squares), keep it only if it does not lose support
+		int m = 0;
+		for (int i = 0; i < count; i++) {
+			if (ReprojectionErrorSq(bestH, srcPoints[i], dstPoints[i]) < thresholdSq) {
+				est->inSrc[m] = srcPoints[i];
+				est->inDst[m] = dstPoints[i];
+				m++;
+			}
+		}
+		float refined[9];
+		if (m >= 4 && SolveHomographyDLT(est->inSrc, est->inDst, m, refined, nullptr) &&
+			CountInliers(est, count, refined, thresholdSq) >= bestInliers) {
+			memcpy(bestH, refined, sizeof(bestH));
+		}
+
+		// 4. Final inlier set + statistics
+		int inliers = 0;
+		double sumSq = 0.0;
+		for (int i = 0; i < count; i++) {
+			const float e = ReprojectionErrorSq(bestH, srcPoints[i], dstPoints[i]);
+			const bool in = e < thresholdSq;
+			if (inlierMask) inlierMask[i] = in ? 1 : 0;
+			if (in) { inliers++; sumSq += e; }
+		}
+
+		PackMatrix(bestH, result);
+		if (fit) {
+			fit->inlierCount = inliers;
+			fit->iterations = iterations;
+			fit->elapsedMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+			fit->rmsError = inliers > 0 ? (float)sqrt(sumSq / inliers) : 0.0f;
+		}
+		return true;
+	}
+
+	// --- STEP 10: NATIVE TARGET PROJECTION ---
+	// Replaces the four managed Camera.WorldToScreenPoint round trips: the target corners are
+	// built from its pose and physical size (ScanTarget.Size), projected with the camera
+	// view-projection matrix (projectionMatrix * worldToCameraMatrix, OpenGL convention like
+	// WorldToScreenPoint) and turned into the same homography as ComputeTransformMatrix.
+	// Corners are in camera pixels, as WorldToScreenPoint returns them; the homography divides
+	// them by screenW/H, so passing Screen.currentResolution reproduces the managed path.
+
+	// TargetProjection.flags
+	// bits 0-3: corner i is in front of the camera, bits 4-7: corner i is inside the viewport
+	enum {
+		PROJECTION_IN_FRONT_SHIFT = 0,
+		PROJECTION_ON_SCREEN_SHIFT = 4,
+		PROJECTION_ALL_IN_FRONT = 0x0F,
+		PROJECTION_ALL_ON_SCREEN = 0xF0
+	};
+
+	struct TargetProjection {
+		Float2 corners[4];              // Screen pixels, same order as ComputeUVs
+		float area;                     // Projected area in pixels^2 (0 if a corner is behind the camera)
+		float visibleFraction;          // Fraction of the projected quad inside the viewport (approx.)
+		int flags;
+	};
+
+	// v' = v + 2w (q x v) + 2 q x (q x v)
+	static inline Float3 Rotate(Float4 q, Float3 v) {
+		const Float3 t = {
+			2.0f * (q.y * v.z - q.z * v.y),
+			2.0f * (q.z * v.x - q.x * v.z),
+			2.0f * (q.x * v.y - q.y * v.x)
+		};
+		return {
+			v.x + q.w * t.x + (q.y * t.z - q.z * t.y),
+			v.y + q.w * t.y + (q.z * t.x - q.x * t.z),
+			v.z + q.w * t.z + (q.x * t.y - q.y * t.x)
+		};
+	}
+
+	// Shoelace area of a quad
+	static inline float QuadArea(const Float2* q) {
+		float a = 0.0f;
+		for (int i = 0; i < 4; i++) {
+			const Float2 p0 = q[i], p1 = q[(i + 1) & 3];
+			a += p0.x * p1.y - p1.x * p0.y;
+		}
+		return fabsf(a) * 0.5f;
+	}
+
+	EXPORT_API bool ProjectTargetTransform(
+		Float3 position, Float4 rotation,   // Target pose (world)
+		Float2 size,                        // Physical size (meters)
+		Float4x4* viewProjection,           // Camera projection * worldToCamera
+		float viewportW, float viewportH,   // Camera pixel size
+		float screenW, float screenH,       // ComputeTransformMatrix normalisation (<= 0: viewport)
+		TargetProjection* projection,       // Output corners/area/flags (optional)
+		Float4x4* result                    // Output Matrix
+	) {
+		// 1. Corners in world space (right = rot * X, forward = rot * Z)
+		const Float3 right = Rotate(rotation, { size.x * 0.5f, 0.0f, 0.0f });
+		const Float3 fwd = Rotate(rotation, { 0.0f, 0.0f, size.y * 0.5f });
+		const float sx[4] = { -1.0f, 1.0f, 1.0f, -1.0f };
+		const float sz[4] = { -1.0f, -1.0f, 1.0f, 1.0f };
+
+		// 2. Project (clip -> NDC -> pixels)
+		const Float4x4& m = *viewProjection;
+		Float2 screen[4];
+		int flags = 0;
+		for (int i = 0; i < 4; i++) {
+			const float px = position.x + sx[i] * right.x + sz[i] * fwd.x;
+			const float py = position.y + sx[i] * right.y + sz[i] * fwd.y;
+			const float pz = position.z + sx[i] * right.z + sz[i] * fwd.z;
+
+			const float cx = m.c0x * px + m.c1x * py + m.c2x * pz + m.c3x;
+			const float cy = m.c0y * px + m.c1y * py + m.c2y * pz + m.c3y;
+			const float cw = m.c0w * px + m.c1w * py + m.c2w * pz + m.c3w;
+
+			if (cw > 1e-6f) {
+				flags |= 1 << (PROJECTION_IN_FRONT_SHIFT + i);
+				const float invW = 1.0f / cw;
+				screen[i].x = (cx * invW * 0.5f + 0.5f) * viewportW;
+				screen[i].y = (cy * invW * 0.5f + 0.5f) * viewportH;
+				if (screen[i].x >= 0.0f && screen[i].x <= viewportW && screen[i].y >= 0.0f && screen[i].y <= viewportH)
+					flags |= 1 << (PROJECTION_ON_SCREEN_SHIFT + i);
+			}
+			else {
+				screen[i].x = -1.0f;
+				screen[i].y = -1.0f;
+			}
+		}
+
+		const bool valid = (flags & PROJECTION_ALL_IN_FRONT) == PROJECTION_ALL_IN_FRONT;
+
+		// 3. Homography (identical to ComputeTransformMatrix on the projected pixels)
+		if (screenW <= 0.0f || screenH <= 0.0f) { screenW = viewportW; screenH = viewportH; }
+		if (valid) ComputeTransformMatrix(screenW, screenH, screen, result);
+		else SetIdentity(result);
+
+		// 4. Area + visibility
+		if (projection) {
+			for (int i = 0; i < 4; i++) projection->corners[i] = screen[i];
+			projection->flags = flags;
+			projection->area = valid ? QuadArea(screen) : 0.0f;
+			projection->visibleFraction = 0.0f;
+
+			if (valid && projection->area > 0.0f) {
+				// Clip the quad against the viewport (Sutherland-Hodgman) for the visible fraction
+				Float2 poly[16], tmp[16];
+				int n = 4;
+				for (int i = 0; i < 4; i++) poly[i] = screen[i];
+				for (int edge = 0; edge < 4 && n > 0; edge++) {
+					int k = 0;
+					for (int i = 0; i < n; i++) {
+						const Float2 a = poly[i], b = poly[(i + 1) % n];
+						float da, db;
+						switch (edge) {
+						case 0: da = a.x; db = b.x; break;                         // x >= 0
+						case 1: da = viewportW - a.x; db = viewportW - b.x; break; // x <= W
+						case 2: da = a.y; db = b.y; break;                         // y >= 0
+						default: da = viewportH - a.y; db = viewportH - b.y; break; // y <= H
+						}
+						if (da >= 0.0f) tmp[k++] = a;
+						if ((da >= 0.0f) != (db >= 0.0f)) {
+							const float t = da / (da - db);
+							tmp[k++] = { a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t };
+						}
+					}
+					n = k;
+					for (int i = 0; i < n; i++) poly[i] = tmp[i];
+				}
+				float clipped = 0.0f;
+				for (int i = 0; i < n; i++) {
+					const Float2 p0 = poly[i], p1 = poly[(i + 1) % n];
+					clipped += p0.x * p1.y - p1.x * p0.y;
+				}
+				projection->visibleFraction = Clamp01(fabsf(clipped) * 0.5f / projection->area);
+			}
+		}
+		return valid;
+	}
+
+	// --- STEP 11: HOMOGRAPHY ANALYSIS ---
+	// Per-capture facts in closed form, before any pixel work:
+	// - w = h20 u + h21 v + h22 is affine over the unit square, so |det J| = |det H| / |w|^3
+	//   is monotone and its extremes sit on the corners (exact min/max footprint)
+	// - the 2x2 Jacobian singular values give the linear sampling scale and anisotropy
+	// - ||H||_F * ||H^-1||_F is used as the conditioning estimate
+
+	// HomographyAnalysis.flags (0 = usable)
+	enum {
+		ANALYSIS_BEHIND_CAMERA = 1,     // A corner maps to w <= 0 (horizon crosses the page)
+		ANALYSIS_FOLDED = 2,            // Projected quad is not convex / orientation flips
+		ANALYSIS_DEGENERATE = 4,        // Singular matrix or vanishing footprint
+		ANALYSIS_ILL_CONDITIONED = 8    // Condition estimate above ANALYSIS_MAX_CONDITION
+	};
+
+	static const float ANALYSIS_MAX_CONDITION = 1e6f;
+
+	struct HomographyAnalysis {
+		float boundsMinX, boundsMinY;   // Projected page bounds (dst pixels)
+		float boundsMaxX, boundsMaxY;
+		float minFootprint;             // |det J|: dst pixels^2 covered by one output texel
+		float maxFootprint;
+		float minScale;                 // Smallest Jacobian singular value (dst pixels per output texel)
+		float maxScale;                 // Largest Jacobian singular value
+		float maxAnisotropy;            // Worst maxScale / minScale ratio at a corner
+		float conditionNumber;
+		int flags;
+	};
+
+	// H maps output UV [0,1]^2 to normalised dst coordinates (ComputeTransformMatrix layout).
+	// dstW/dstH: pixel size of the destination (screen / camera image).
+	// outW/outH: resolution of the unwarped output texture.
+	// Returns the flags (0 = usable); 'analysis' is optional.
+	EXPORT_API int AnalyzeTransformMatrix(
+		Float4x4* matrix,
+		float dstW, float dstH,
+		float outW, float outH,
+		HomographyAnalysis* analysis
+	) {
+		float h[9], inv[9];
+		UnpackMatrix(matrix, h);
+
+		HomographyAnalysis a;
+		memset(&a, 0, sizeof(a));
+		a.minFootprint = 1e30f; a.minScale = 1e30f;
+		a.boundsMinX = 1e30f; a.boundsMinY = 1e30f;
+		a.boundsMaxX = -1e30f; a.boundsMaxY = -1e30f;
+
+		// 1. Conditioning
+		const float det = Mat3Adjugate(h, inv);
+		if (fabsf(det) < 1e-12f) {
+			a.flags |= ANALYSIS_DEGENERATE;
+			a.conditionNumber = 1e30f;
+		}
+		else {
+			float nH = 0.0f, nI = 0.0f;
+			for (int i = 0; i < 9; i++) { nH += h[i] * h[i]; nI += inv[i] * inv[i]; }
+			a.conditionNumber = sqrtf(nH) * sqrtf(nI) / fabsf(det);
+			if (a.conditionNumber > ANALYSIS_MAX_CONDITION) a.flags |= ANALYSIS_ILL_CONDITIONED;
+		}
+
+		// 2. Corners: bounds, footprint and scale
+		// J (dst px per output texel) = diag(dstW, dstH) * dN/dUV * diag(1/outW, 1/outH)
+		const float cu[4] = { 0.0f, 1.0f, 1.0f, 0.0f };
+		const float cv[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+		Float2 quad[4];
+		float wSign = 0.0f;
+
+		for (int i = 0; i < 4; i++) {
+			const float u = cu[i], v = cv[i];
+			const float w = h[6] * u + h[7] * v + h[8];
+			if (w <= 1e-8f) { a.flags |= ANALYSIS_BEHIND_CAMERA; quad[i].x = quad[i].y = 0.0f; continue; }
+
+			const float invW = 1.0f / w;
+			const float x = (h[0] * u + h[1] * v + h[2]) * invW;
+			const float y = (h[3] * u + h[4] * v + h[5]) * invW;
+			quad[i].x = x * dstW; quad[i].y = y * dstH;
+
+			a.boundsMinX = fminf(a.boundsMinX, quad[i].x); a.boundsMaxX = fmaxf(a.boundsMaxX, quad[i].x);
+			a.boundsMinY = fminf(a.boundsMinY, quad[i].y); a.boundsMaxY = fmaxf(a.boundsMaxY, quad[i].y);
+
+			// Jacobian of the projective map at (u, v)
+			const float ja = (h[0] - x * h[6]) * invW * dstW / outW;
+			const float jb = (h[1] - x * h[7]) * invW * dstW / outH;
+			const float jc = (h[3] - y * h[6]) * invW * dstH / outW;
+			const float jd = (h[4] - y * h[7]) * invW * dstH / outH;
+
+			const float jdet = ja * jd - jb * jc;
+			if (wSign == 0.0f) wSign = jdet;
+			else if (wSign * jdet < 0.0f) a.flags |= ANALYSIS_FOLDED;
+
+			const float fp = fabsf(jdet);
+			a.minFootprint = fminf(a.minFootprint, fp);
+			a.maxFootprint = fmaxf(a.maxFootprint, fp);
+
+			// Closed-form 2x2 singular values
+			const float e = ja * ja + jb * jb + jc * jc + jd * jd;
+			const float disc = sqrtf(fmaxf(e * e - 4.0f * jdet * jdet, 0.0f));
+			const float sMax = sqrtf(0.5f * (e + disc));
+			const float sMin = sqrtf(fmaxf(0.5f * (e - disc), 0.0f));
+			a.maxScale = fmaxf(a.maxScale, sMax);
+			a.minScale = fminf(a.minScale, sMin);
+			a.maxAnisotropy = fmaxf(a.maxAnisotropy, sMin > 1e-12f ? sMax / sMin : 1e30f);
+		}
+
+		// 3. Convexity of the projected quad (all edge cross products share a sign)
+		if (!(a.flags & ANALYSIS_BEHIND_CAMERA)) {
+			float sign = 0.0f;
+			for (int i = 0; i < 4; i++) {
+				const Float2 p0 = quad[i], p1 = quad[(i + 1) & 3], p2 = quad[(i + 2) & 3];
+				const float cross = (p1.x - p0.x) * (p2.y - p1.y) - (p1.y - p0.y) * (p2.x - p1.x);
+				if (sign == 0.0f) sign = cross;
+				else if (sign * cross <= 0.0f) a.flags |= ANALYSIS_FOLDED;
+			}
+		}
+		else {
+			a.minFootprint = a.maxFootprint = 0.0f;
+			a.minScale = a.maxScale = 0.0f;
+		}
+
+		if (a.minFootprint < 1e-9f) a.flags |= ANALYSIS_DEGENERATE;
+
+		if (analysis) *analysis = a;
+		return a.flags;
+	}
 }
 
@@ -0,0 +1,425 @@
+// Felina photometric alignment
+// Refines the pose-based homography so the capture lines up with the reference marker.
+// Inverse-compositional Lucas-Kanade (Baker & Matthews), coarse-to-fine:
+// everything that depends only on the reference (pyramid, gradients, steepest-descent
+// images, Hessian) is built once in CreateReferenceAligner; a refinement only samples
+// the camera image and solves an 8x8 system per iteration.
+
+#include <vector>
+#include <algorithm> // std::nth_element
+#include <chrono>    // elapsed time
+
+#include "FelinaCommon.h"
+
+// --- INTERNAL HELPERS ---
+
+static const int ALIGN_MAX_LEVELS = 5;
+static const int ALIGN_MAX_TEMPLATE_SIZE = 512;   // Finest template level (longest side)
+static const int ALIGN_MAX_POINTS = 6000;         // Selected pixels per level
+static const float ALIGN_MAX_RESIDUAL = 0.25f;    // Residual clamp (occlusion / strokes)
+
+struct AlignLevel {
+	int count;
+	std::vector<float> qx, qy;      // Normalised template coordinates
+	std::vector<float> t;           // Template intensity
+	std::vector<float> sd;          // 8 steepest-descent values per point
+	double hessianInv[64];
+};
+
+struct ReferenceAligner {
+	int levels;
+	int width, height;              // Finest template size
+	float centerX, centerY, scale;  // Template pixel -> normalised coordinate (q = (x - c) / scale)
+	AlignLevel level[ALIGN_MAX_LEVELS];
+
+	// Per-call scratch (one refinement at a time per aligner)
+	std::vector<float> image[ALIGN_MAX_LEVELS];
+	int imageW[ALIGN_MAX_LEVELS], imageH[ALIGN_MAX_LEVELS];
+	std::vector<float> samples;
+};
+
+static inline float Luma(const unsigned char* p) {
+	return (0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]) * (1.0f / 255.0f);
+}
+
+// 2x box downsample (odd trailing row/column dropped)
+static void Downsample2x(const std::vector<float>& src, int w, int h, std::vector<float>& dst, int& dw, int& dh) {
+	dw = w / 2; dh = h / 2;
+	dst.resize((size_t)dw * dh);
+	for (int y = 0; y < dh; y++) {
+		const float* r0 = &src[(size_t)(2 * y) * w];
+		const float* r1 = r0 + w;
+		float* out = &dst[(size_t)y * dw];
+		for (int x = 0; x < dw; x++)
+			out[x] = 0.25f * (r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1]);
+	}
+}
+
+// Bilinear sample at continuous pixel coordinates (pixel centres at i + 0.5).
+// Returns false outside the image.
+static inline bool SampleBilinear(const float* img, int w, int h, float x, float y, float* out) {
+	x -= 0.5f; y -= 0.5f;
+	if (x < 0.0f || y < 0.0f || x > (float)(w - 1) || y > (float)(h - 1)) return false;
+	int ix = (int)x, iy = (int)y;
+	if (ix > w - 2) ix = w - 2;
+	if (iy > h - 2) iy = h - 2;
+	const float fx = x - ix, fy = y - iy;
+	const float* p = img + (size_t)iy * w + ix;
+	const float top = p[0] + (p[1] - p[0]) * fx;
+	const float bot = p[w] + (p[w + 1] - p[w]) * fx;
+	*out = top + (bot - top) * fy;
+	return true;
+}
+
+// Gauss-Jordan inverse of an 8x8 symmetric positive (semi)definite matrix
+static bool Invert8(const double* m, double* inv) {
+	double a[8][16];
+	for (int r = 0; r < 8; r++) {
+		for (int c = 0; c < 8; c++) { a[r][c] = m[r * 8 + c]; a[r][c + 8] = (r == c) ? 1.0 : 0.0; }
+	}
+	for (int c = 0; c < 8; c++) {
+		int piv = c;
+		for (int r = c + 1; r < 8; r++) if (fabs(a[r][c]) > fabs(a[piv][c])) piv = r;
+		if (fabs(a[piv][c]) < 1e-12) return false;
+		if (piv != c) for (int k = 0; k < 16; k++) { const double t = a[c][k]; a[c][k] = a[piv][k]; a[piv][k] = t; }
+		const double invP = 1.0 / a[c][c];
+		for (int k = 0; k < 16; k++) a[c][k] *= invP;
+		for (int r = 0; r < 8; r++) {
+			if (r == c) continue;
+			const double f = a[r][c];
+			if (f == 0.0) continue;
+			for (int k = 0; k < 16; k++) a[r][k] -= f * a[c][k];
+		}
+	}
+	for (int r = 0; r < 8; r++)
+		for (int c = 0; c < 8; c++) inv[r * 8 + c] = a[r][c + 8];
+	return true;
+}
+
+// Pick the strongest-gradient pixels of one template level and precompute SD images + Hessian
+static bool BuildAlignLevel(const std::vector<float>& img, int w, int h, float levelScale,
+	float centerX, float centerY, float scale, AlignLevel& level) {
+	level.count = 0;
+	if (w < 8 || h < 8) return false;
+
+	// 1. Gradient magnitudes (central differences, 1px border skipped)
+	std::vector<float> mag((size_t)w * h, 0.0f);
+	for (int y = 1; y < h - 1; y++) {
+		for (int x = 1; x < w - 1; x++) {
+			const size_t i = (size_t)y * w + x;
+			const float gx = 0.5f * (img[i + 1] - img[i - 1]);
+			const float gy = 0.5f * (img[i + w] - img[i - w]);
+			mag[i] = gx * gx + gy * gy;
+		}
+	}
+
+	// 2. Threshold so at most ALIGN_MAX_POINTS pixels survive
+	float threshold = 1e-5f;
+	std::vector<float> sorted(mag);
+	if ((int)sorted.size() > ALIGN_MAX_POINTS) {
+		std::nth_element(sorted.begin(), sorted.end() - ALIGN_MAX_POINTS, sorted.end());
+		const float kth = *(sorted.end() - ALIGN_MAX_POINTS);
+		if (kth > threshold) threshold = kth;
+	}
+
+	// 3. Steepest descent images in normalised template coordinates
+	// Pixel x at this level maps to finest-level x0 = x / levelScale, q = (x0 - c) / scale
+	const float dqdx = 1.0f / (levelScale * scale);
+	double hess[64] = { 0.0 };
+
+	for (int y = 1; y < h - 1; y++) {
+		for (int x = 1; x < w - 1; x++) {
+			const size_t i = (size_t)y * w + x;
+			if (mag[i] < threshold || level.count >= ALIGN_MAX_POINTS) continue;
+
+			const float gx = 0.5f * (img[i + 1] - img[i - 1]) / dqdx;
+			const float gy = 0.5f * (img[i + w] - img[i - w]) / dqdx;
+			const float qx = ((x + 0.5f) / levelScale - centerX) / scale;
+			const float qy = ((y + 0.5f) / levelScale - centerY) / scale;
+
+			// dW/dp at identity: [x 0 y 0 1 0 -x^2 -xy ; 0 x 0 y 0 1 -xy -y^2]
+			const float sd[8] = {
+				gx * qx, gy * qx, gx * qy, gy * qy, gx, gy,
+				-qx * (gx * qx + gy * qy), -qy * (gx * qx + gy * qy)
+			};
+
+			level.qx.push_back(qx);
+			level.qy.push_back(qy);
+			level.t.push_back(img[i]);
+			for (int k = 0; k < 8; k++) level.sd.push_back(sd[k]);
+			for (int r = 0; r < 8; r++)
+				for (int c = 0; c < 8; c++) hess[r * 8 + c] += (double)sd[r] * sd[c];
+			level.count++;
+		}
+	}
+
+	if (level.count < 16) { level.count = 0; return false; }
+	if (!Invert8(hess, level.hessianInv)) { level.count = 0; return false; }
+	return true;
+}
+
+// Residual statistics + gain/bias compensated steepest-descent update for one level.
+// hq maps normalised template coordinates to level image pixels (row-major).
+static bool AlignStep(ReferenceAligner* al, int l, const float* hq, double* dp, float* rms) {
+	const AlignLevel& level = al->level[l];
+	const float* img = al->image[l].data();
+	const int w = al->imageW[l], h = al->imageH[l];
+
+	// 1. Sample I(W(q)) and fit the photometric gain/bias I = a*T + b
+	double sT = 0.0, sI = 0.0, sTT = 0.0, sTI = 0.0;
+	int n = 0;
+	std::vector<float>& samples = al->samples;
+	samples.resize(level.count);
+
+	for (int i = 0; i < level.count; i++) {
+		const float qx = level.qx[i], qy = level.qy[i];
+		const float iw = hq[6] * qx + hq[7] * qy + hq[8];
+		float v = -1.0f;
+		if (iw > 1e-8f) {
+			const float invW = 1.0f / iw;
+			if (!SampleBilinear(img, w, h, (hq[0] * qx + hq[1] * qy + hq[2]) * invW,
+				(hq[3] * qx + hq[4] * qy + hq[5]) * invW, &v)) v = -1.0f;
+		}
+		samples[i] = v;
+		if (v < 0.0f) continue;
+		const double t = level.t[i];
+		sT += t; sI += v; sTT += t * t; sTI += t * v;
+		n++;
+	}
+	if (n < 16) return false;
+
+	const double varT = sTT - sT * sT / n;
+	double gain = varT > 1e-9 ? (sTI - sT * sI / n) / varT : 1.0;
+	if (gain < 0.2) gain = 0.2;
+	if (gain > 5.0) gain = 5.0;
+	const double bias = (sI - gain * sT) / n;
+	const double invGain = 1.0 / gain;
+
+	// 2. b = sum SD * e with clamped residuals (keeps the precomputed Hessian valid)
+	double b[8] = { 0.0 };
+	double sumSq = 0.0;
+	for (int i = 0; i < level.count; i++) {
+		if (samples[i] < 0.0f) continue;
+		float e = (float)((samples[i] - bias) * invGain) - level.t[i];
+		sumSq += (double)e * e;
+		if (e > ALIGN_MAX_RESIDUAL) e = ALIGN_MAX_RESIDUAL;
+		if (e < -ALIGN_MAX_RESIDUAL) e = -ALIGN_MAX_RESIDUAL;
+		const float* sd = &level.sd[(size_t)i * 8];
+		for (int k = 0; k < 8; k++) b[k] += (double)sd[k] * e;
+	}
+	*rms = (float)sqrt(sumSq / n);
+
+	for (int r = 0; r < 8; r++) {
+		double acc = 0.0;
+		for (int c = 0; c < 8; c++) acc += level.hessianInv[r * 8 + c] * b[c];
+		dp[r] = acc;
+	}
+	return true;
+}
+
+extern "C" {
+
+	struct AlignResult {
+		float initialError;             // RMS photometric residual before refinement (0..1 intensity)
+		float finalError;               // RMS photometric residual after refinement
+		int iterations;                 // Total iterations over all levels
+		float elapsedMs;
+	};
+
+	// --- STEP 9: PHOTOMETRIC REFINEMENT ---
+	// Precompute the reference pyramid, gradients and Hessians once per reference texture.
+	// rgba: 8-bit RGBA, rows in Unity order (row 0 = v 0). levels: pyramid depth (1..ALIGN_MAX_LEVELS).
+	EXPORT_API void* CreateReferenceAligner(unsigned char* rgba, int width, int height, int levels) {
+		if (!rgba || width < 16 || height < 16) return nullptr;
+		if (levels < 1) levels = 1;
+		if (levels > ALIGN_MAX_LEVELS) levels = ALIGN_MAX_LEVELS;
+
+		// 1. Luma + downsample to the working resolution
+		std::vector<float> img((size_t)width * height);
+		for (size_t i = 0; i < img.size(); i++) img[i] = Luma(rgba + i * 4);
+
+		int w = width, h = height;
+		while (w > ALIGN_MAX_TEMPLATE_SIZE || h > ALIGN_MAX_TEMPLATE_SIZE) {
+			std::vector<float> next;
+			int nw, nh;
+			Downsample2x(img, w, h, next, nw, nh);
+			img.swap(next); w = nw; h = nh;
+		}
+
+		ReferenceAligner* al = new ReferenceAligner();
+		al->width = w;
+		al->height = h;
+		al->centerX = w * 0.5f;
+		al->centerY = h * 0.5f;
+		al->scale = (w > h ? w : h) * 0.5f;
+		al->levels = 0;
+
+		// 2. Per-level selection, SD images and Hessian
+		float levelScale = 1.0f;
+		for (int l = 0; l < levels; l++) {
+			if (!BuildAlignLevel(img, w, h, levelScale, al->centerX, al->centerY, al->scale, al->level[l])) break;
+			al->levels++;
+
+			std::vector<float> next;
+			int nw, nh;
+			Downsample2x(img, w, h, next, nw, nh);
+			img.swap(next); w = nw; h = nh;
+			levelScale *= 0.5f;
+		}
+
+		if (al->levels == 0) { delete al; return nullptr; }
+		return al;
+	}
+
+	EXPORT_API void DestroyReferenceAligner(void* aligner) {
+		delete (ReferenceAligner*)aligner;
+	}
+
+	// Refine 'initial' (reference UV [0,1]^2 -> normalised image coordinates, as produced by
+	// ComputeTransformMatrix) against the reference. image: 8-bit RGBA, Unity row order.
+	// maxIterations is per pyramid level. Only the region around the projected page is
+	// converted to luma. If the photometric error does not improve, 'initial' is returned
+	// unchanged and the call returns false.
+	EXPORT_API bool RefineTransformMatrix(
+		void* aligner,
+		unsigned char* image, int width, int height,
+		Float4x4* initial,
+		int maxIterations,
+		Float4x4* result,
+		AlignResult* info
+	) {
+		typedef std::chrono::steady_clock Clock;
+		const Clock::time_point start = Clock::now();
+
+		ReferenceAligner* al = (ReferenceAligner*)aligner;
+		if (info) memset(info, 0, sizeof(AlignResult));
+		if (!initial || !result) return false;
+		*result = *initial;
+		if (!al || !image || width < 16 || height < 16) return false;
+		if (maxIterations <= 0) maxIterations = 30;
+
+		// 1. q (normalised template) -> level-0 image pixels: Himg = S_img * H * S_uv
+		// where u = (s*q + c) / W
+		float huv[9];
+		UnpackMatrix(initial, huv);
+		const float qToUv[9] = {
+			al->scale / al->width, 0.0f, al->centerX / al->width,
+			0.0f, al->scale / al->height, al->centerY / al->height,
+			0.0f, 0.0f, 1.0f
+		};
+		const float uvToPx[9] = { (float)width, 0.0f, 0.0f, 0.0f, (float)height, 0.0f, 0.0f, 0.0f, 1.0f };
+		float tmp[9], hq[9];
+		Mat3Mul(huv, qToUv, tmp);
+		Mat3Mul(uvToPx, tmp, hq);
+
+		// 2. ROI = projected page bounds + 10% margin, aligned to the coarsest level
+		float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+		const float cornersQ[4][2] = {
+			{ -al->centerX / al->scale, -al->centerY / al->scale },
+			{ (al->width - al->centerX) / al->scale, -al->centerY / al->scale },
+			{ (al->width - al->centerX) / al->scale, (al->height - al->centerY) / al->scale },
+			{ -al->centerX / al->scale, (al->height - al->centerY) / al->scale }
+		};
+		for (int i = 0; i < 4; i++) {
+			const float qx = cornersQ[i][0], qy = cornersQ[i][1];
+			const float cw = hq[6] * qx + hq[7] * qy + hq[8];
+			if (cw <= 1e-8f) return false; // page corner behind the camera
+			const float px = (hq[0] * qx + hq[1] * qy + hq[2]) / cw;
+			const float py = (hq[3] * qx + hq[4] * qy + hq[5]) / cw;
+			minX = std::min(minX, px); maxX = std::max(maxX, px);
+			minY = std::min(minY, py); maxY = std::max(maxY, py);
+		}
+		const float margin = 0.1f * std::max(maxX - minX, maxY - minY);
+		const int align = 1 << (al->levels - 1);
+		int rx0 = std::max(0, (int)floorf(minX - margin)) & ~(align - 1);
+		int ry0 = std::max(0, (int)floorf(minY - margin)) & ~(align - 1);
+		int rx1 = std::min(width, (int)ceilf(maxX + margin));
+		int ry1 = std::min(height, (int)ceilf(maxY + margin));
+		if (rx1 - rx0 < 16 || ry1 - ry0 < 16) return false;
+
+		// 3. Luma pyramid of the ROI
+		int rw = rx1 - rx0, rh = ry1 - ry0;
+		al->image[0].resize((size_t)rw * rh);
+		for (int y = 0; y < rh; y++) {
+			const unsigned char* row = image + ((size_t)(ry0 + y) * width + rx0) * 4;
+			float* out = &al->image[0][(size_t)y * rw];
+			for (int x = 0; x < rw; x++) out[x] = Luma(row + x * 4);
+		}
+		al->imageW[0] = rw; al->imageH[0] = rh;
+		for (int l = 1; l < al->levels; l++)
+			Downsample2x(al->image[l - 1], al->imageW[l - 1], al->imageH[l - 1], al->image[l], al->imageW[l], al->imageH[l]);
+
+		// Shift into ROI coordinates
+		const float toRoi[9] = { 1.0f, 0.0f, (float)-rx0, 0.0f, 1.0f, (float)-ry0, 0.0f, 0.0f, 1.0f };
+		Mat3Mul(toRoi, hq, tmp);
+		memcpy(hq, tmp, sizeof(hq));
+
+		// 4. Initial error at the finest level
+		double dp[8];
+		float initialRms = 0.0f, rms = 0.0f;
+		if (!AlignStep(al, 0, hq, dp, &initialRms)) return false;
+
+		// 5. Coarse-to-fine inverse compositional iterations: H <- H * W(dp)^-1
+		float best[9];
+		memcpy(best, hq, sizeof(best));
+		int iterations = 0;
+		for (int l = al->levels - 1; l >= 0; l--) {
+			const float s = 1.0f / (float)(1 << l);
+			const float down[9] = { s, 0.0f, 0.0f, 0.0f, s, 0.0f, 0.0f, 0.0f, 1.0f };
+			const float up[9] = { 1.0f / s, 0.0f, 0.0f, 0.0f, 1.0f / s, 0.0f, 0.0f, 0.0f, 1.0f };
+			float hl[9];
+			Mat3Mul(down, hq, hl);
+
+			for (int it = 0; it < maxIterations; it++) {
+				if (!AlignStep(al, l, hl, dp, &rms)) break;
+				iterations++;
+
+				const float dw[9] = {
+					1.0f + (float)dp[0], (float)dp[2], (float)dp[4],
+					(float)dp[1], 1.0f + (float)dp[3], (float)dp[5],
+					(float)dp[6], (float)dp[7], 1.0f
+				};
+				float dwInv[9];
+				if (!Mat3Inverse(dw, dwInv)) break;
+				Mat3Mul(hl, dwInv, tmp);
+				Mat3Normalize(tmp);
+				memcpy(hl, tmp, sizeof(hl));
+
+				// Converged when the update moves the template by < 0.01 template pixels
+				const double shift = (fabs(dp[4]) + fabs(dp[5])) * al->scale * s;
+				if (shift < 0.01 && fabs(dp[6]) + fabs(dp[7]) < 1e-6) break;
+			}
+			Mat3Mul(up, hl, hq);
+		}
+
+		// 6. Keep the result only if the finest-level error went down
+		if (!AlignStep(al, 0, hq, dp, &rms) || rms >= initialRms) {
+			memcpy(hq, best, sizeof(hq));
+			rms = initialRms;
+		}
+		const bool improved = memcmp(hq, best, sizeof(hq)) != 0;
+
+		// 7. Back to UV -> normalised image coordinates
+		const float fromRoi[9] = { 1.0f, 0.0f, (float)rx0, 0.0f, 1.0f, (float)ry0, 0.0f, 0.0f, 1.0f };
+		const float pxToUv[9] = { 1.0f / width, 0.0f, 0.0f, 0.0f, 1.0f / height, 0.0f, 0.0f, 0.0f, 1.0f };
+		const float uvToQ[9] = {
+			al->width / al->scale, 0.0f, -al->centerX / al->scale,
+			0.0f, al->height / al->scale, -al->centerY / al->scale,
+			0.0f, 0.0f, 1.0f
+		};
+		float a[9], b[9];
+		Mat3Mul(fromRoi, hq, a);
+		Mat3Mul(pxToUv, a, b);
+		Mat3Mul(b, uvToQ, a);
+		Mat3Normalize(a);
+		if (improved) PackMatrix(a, result);
+
+		if (info) {
+			info->initialError = initialRms;
+			info->finalError = rms;
+			info->iterations = iterations;
+			info->elapsedMs = std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+		}
+		return improved;
+	}
+}
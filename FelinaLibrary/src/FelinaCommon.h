@@ -0,0 +1,269 @@
+// Felina internal header
+// Shared by every translation unit of the native library: export macro, SIMD selection,
+// the Unity.Mathematics-compatible structs, the small homography helpers and the worker pool.
+#pragma once
+
+#include <string.h>
+#include <math.h>
+#include <stdlib.h> // malloc/free
+#include <functional>
+#include <memory>
+#include <vector>
+
+// SIMD selection (SSE2 is baseline on x86_64, NEON on arm64). FELINA_NO_SIMD forces the
+// scalar paths; the tests build the library both ways and compare.
+#if defined(FELINA_NO_SIMD)
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define FELINA_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FELINA_SSE 1
+#endif
+
+// Cache hint (read, keep in all levels)
+#if defined(FELINA_SSE)
+#define FELINA_PREFETCH(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#elif defined(__GNUC__) || defined(__clang__)
+#define FELINA_PREFETCH(p) __builtin_prefetch(p)
+#else
+#define FELINA_PREFETCH(p) ((void)0)
+#endif
+
+// Export macro
+#if defined(_WIN32)
+#define EXPORT_API __declspec(dllexport) 
+#else
+#define EXPORT_API __attribute__((visibility("default")))
+#endif
+
+extern "C" {
+
+	// --- STRUCTS (Matches Unity.Mathematics) ---
+	struct Float2 { float x, y; };
+	struct Float3 { float x, y, z; };
+	struct Float4 { float x, y, z, w; }; // Quaternion
+	struct Float4x4 {
+		float c0x, c0y, c0z, c0w;
+		float c1x, c1y, c1z, c1w;
+		float c2x, c2y, c2z, c2w;
+		float c3x, c3y, c3z, c3w;
+	};
+
+	// --- RESULT STRUCTS (shared with tests/) ---
+	struct RobustFit {                  // EstimateHomographyRobust (Felina.cpp)
+		int inlierCount;
+		int iterations;                 // Hypotheses generated and scored
+		float elapsedMs;                // Wall time spent (iterations / elapsedMs = throughput)
+		float rmsError;                 // RMS error of the inliers after refit (dst units)
+	};
+
+	// --- SIMD HELPERS (Internal) ---
+	// Thin 4-lane float wrappers so kernels are written once for SSE2 and NEON.
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+#if defined(FELINA_SSE)
+	typedef __m128 Vec4f;
+	static inline Vec4f V4Load(const float* p) { return _mm_loadu_ps(p); }
+	static inline Vec4f V4Set(float v) { return _mm_set1_ps(v); }
+	static inline Vec4f V4Add(Vec4f a, Vec4f b) { return _mm_add_ps(a, b); }
+	static inline Vec4f V4Sub(Vec4f a, Vec4f b) { return _mm_sub_ps(a, b); }
+	static inline Vec4f V4Mul(Vec4f a, Vec4f b) { return _mm_mul_ps(a, b); }
+	static inline Vec4f V4Div(Vec4f a, Vec4f b) { return _mm_div_ps(a, b); }
+	static inline Vec4f V4Min(Vec4f a, Vec4f b) { return _mm_min_ps(a, b); }
+	static inline Vec4f V4Max(Vec4f a, Vec4f b) { return _mm_max_ps(a, b); }
+	static inline void V4Store(float* p, Vec4f v) { _mm_storeu_ps(p, v); }
+	// Lanes where |den| >= eps keep 'v', the rest become 0
+	static inline Vec4f V4SelectAbsGE(Vec4f den, Vec4f eps, Vec4f v) {
+		const Vec4f absDen = _mm_andnot_ps(_mm_set1_ps(-0.0f), den);
+		return _mm_and_ps(_mm_cmpge_ps(absDen, eps), v);
+	}
+	// Comparison masks (all bits set per true lane) and lane count
+	static inline Vec4f V4CmpLt(Vec4f a, Vec4f b) { return _mm_cmplt_ps(a, b); }
+	static inline Vec4f V4CmpGt(Vec4f a, Vec4f b) { return _mm_cmpgt_ps(a, b); }
+	static inline Vec4f V4And(Vec4f a, Vec4f b) { return _mm_and_ps(a, b); }
+	static inline int V4CountMask(Vec4f m) {
+		const int bits = _mm_movemask_ps(m);
+		return (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+	}
+	// Transpose 4 row vectors and store them as the same column of 4 consecutive Float4x4
+	static inline void V4StoreColumn(float* dst, Vec4f r0, Vec4f r1, Vec4f r2, Vec4f r3) {
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_storeu_ps(dst + 0, r0);
+		_mm_storeu_ps(dst + 16, r1);
+		_mm_storeu_ps(dst + 32, r2);
+		_mm_storeu_ps(dst + 48, r3);
+	}
+#else
+	typedef float32x4_t Vec4f;
+	static inline Vec4f V4Load(const float* p) { return vld1q_f32(p); }
+	static inline Vec4f V4Set(float v) { return vdupq_n_f32(v); }
+	static inline Vec4f V4Add(Vec4f a, Vec4f b) { return vaddq_f32(a, b); }
+	static inline Vec4f V4Sub(Vec4f a, Vec4f b) { return vsubq_f32(a, b); }
+	static inline Vec4f V4Mul(Vec4f a, Vec4f b) { return vmulq_f32(a, b); }
+	static inline Vec4f V4Div(Vec4f a, Vec4f b) { return vdivq_f32(a, b); }
+	static inline Vec4f V4Min(Vec4f a, Vec4f b) { return vminq_f32(a, b); }
+	static inline Vec4f V4Max(Vec4f a, Vec4f b) { return vmaxq_f32(a, b); }
+	static inline void V4Store(float* p, Vec4f v) { vst1q_f32(p, v); }
+	static inline Vec4f V4SelectAbsGE(Vec4f den, Vec4f eps, Vec4f v) {
+		const uint32x4_t mask = vcgeq_f32(vabsq_f32(den), eps);
+		return vreinterpretq_f32_u32(vandq_u32(mask, vreinterpretq_u32_f32(v)));
+	}
+	static inline Vec4f V4CmpLt(Vec4f a, Vec4f b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+	static inline Vec4f V4CmpGt(Vec4f a, Vec4f b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+	static inline Vec4f V4And(Vec4f a, Vec4f b) {
+		return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+	}
+	static inline int V4CountMask(Vec4f m) {
+		return (int)vaddvq_u32(vshrq_n_u32(vreinterpretq_u32_f32(m), 31));
+	}
+	static inline void V4StoreColumn(float* dst, Vec4f r0, Vec4f r1, Vec4f r2, Vec4f r3) {
+		const float32x4x2_t t01 = vtrnq_f32(r0, r1);
+		const float32x4x2_t t23 = vtrnq_f32(r2, r3);
+		vst1q_f32(dst + 0, vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+		vst1q_f32(dst + 16, vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+		vst1q_f32(dst + 32, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+		vst1q_f32(dst + 48, vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+	}
+#endif
+#endif
+
+	// --- HOMOGRAPHY HELPERS (Internal) ---
+	// 3x3 homographies are kept row-major in float[9]: h[0..2] = row 0, h[3..5] = row 1, h[6..8] = row 2.
+
+	static inline void SetIdentity(Float4x4* result) {
+		result->c0x = 1.0f; result->c0y = 0.0f; result->c0z = 0.0f; result->c0w = 0.0f;
+		result->c1x = 0.0f; result->c1y = 1.0f; result->c1z = 0.0f; result->c1w = 0.0f;
+		result->c2x = 0.0f; result->c2y = 0.0f; result->c2z = 1.0f; result->c2w = 0.0f;
+		result->c3x = 0.0f; result->c3y = 0.0f; result->c3z = 0.0f; result->c3w = 1.0f;
+	}
+
+	// Pack a row-major 3x3 into the column-major Float4x4 layout the shaders expect
+	static inline void PackMatrix(const float* h, Float4x4* result) {
+		result->c0x = h[0]; result->c0y = h[3]; result->c0z = h[6]; result->c0w = 0.0f;
+		result->c1x = h[1]; result->c1y = h[4]; result->c1z = h[7]; result->c1w = 0.0f;
+		result->c2x = h[2]; result->c2y = h[5]; result->c2z = h[8]; result->c2w = 0.0f;
+		result->c3x = 0.0f; result->c3y = 0.0f; result->c3z = 0.0f; result->c3w = 1.0f;
+	}
+
+	static inline void UnpackMatrix(const Float4x4* m, float* h) {
+		h[0] = m->c0x; h[1] = m->c1x; h[2] = m->c2x;
+		h[3] = m->c0y; h[4] = m->c1y; h[5] = m->c2y;
+		h[6] = m->c0z; h[7] = m->c1z; h[8] = m->c2z;
+	}
+
+	static inline void Mat3Mul(const float* a, const float* b, float* r) {
+		for (int i = 0; i < 3; i++) {
+			const float a0 = a[i * 3 + 0], a1 = a[i * 3 + 1], a2 = a[i * 3 + 2];
+			r[i * 3 + 0] = a0 * b[0] + a1 * b[3] + a2 * b[6];
+			r[i * 3 + 1] = a0 * b[1] + a1 * b[4] + a2 * b[7];
+			r[i * 3 + 2] = a0 * b[2] + a1 * b[5] + a2 * b[8];
+		}
+	}
+
+	// Adjugate (transpose of the cofactor matrix). Returns the determinant.
+	// For a homography the adjugate is already an inverse up to scale.
+	static inline float Mat3Adjugate(const float* m, float* adj) {
+		adj[0] = m[4] * m[8] - m[5] * m[7];
+		adj[1] = m[2] * m[7] - m[1] * m[8];
+		adj[2] = m[1] * m[5] - m[2] * m[4];
+		adj[3] = m[5] * m[6] - m[3] * m[8];
+		adj[4] = m[0] * m[8] - m[2] * m[6];
+		adj[5] = m[2] * m[3] - m[0] * m[5];
+		adj[6] = m[3] * m[7] - m[4] * m[6];
+		adj[7] = m[1] * m[6] - m[0] * m[7];
+		adj[8] = m[0] * m[4] - m[1] * m[3];
+		return m[0] * adj[0] + m[1] * adj[3] + m[2] * adj[6];
+	}
+
+	// Analytic inverse (adjugate / det). Returns false if the matrix is singular.
+	static inline bool Mat3Inverse(const float* m, float* inv) {
+		const float det = Mat3Adjugate(m, inv);
+		if (fabsf(det) < 1e-12f) return false;
+		const float invDet = 1.0f / det;
+		for (int i = 0; i < 9; i++) inv[i] *= invDet;
+		return true;
+	}
+
+	// Scale so h22 == 1 (keeps the shader-side divide well conditioned)
+	static inline void Mat3Normalize(float* h) {
+		if (fabsf(h[8]) < 1e-12f) return;
+		const float s = 1.0f / h[8];
+		for (int i = 0; i < 9; i++) h[i] *= s;
+		h[8] = 1.0f;
+	}
+
+	// CLOSED-FORM HOMOGRAPHY for mapping the unit square to a quadrilateral
+	// q0 = H(0,0), q1 = H(1,0), q2 = H(1,1), q3 = H(0,1)
+	static inline void SquareToQuad(const Float2* q, float* h) {
+		const float x0 = q[0].x, y0 = q[0].y;
+		const float x1 = q[1].x, y1 = q[1].y;
+		const float x2 = q[2].x, y2 = q[2].y;
+		const float x3 = q[3].x, y3 = q[3].y;
+
+		// Compute differences
+		const float dx1 = x1 - x2;
+		const float dx2 = x3 - x2;
+		const float dx3 = x0 - x1 + x2 - x3;
+		const float dy1 = y1 - y2;
+		const float dy2 = y3 - y2;
+		const float dy3 = y0 - y1 + y2 - y3;
+
+		const float EPS = 1e-9f;
+		float h20 = 0.0f, h21 = 0.0f;
+		const float den = dx1 * dy2 - dy1 * dx2;
+		if (fabsf(den) >= EPS) {
+			h20 = (dx3 * dy2 - dy3 * dx2) / den;
+			h21 = (dx1 * dy3 - dy1 * dx3) / den;
+		}
+		// else: affine case (or degenerate) - perspective terms stay zero
+
+		h[0] = x1 - x0 + h20 * x1; h[1] = x3 - x0 + h21 * x3; h[2] = x0;
+		h[3] = y1 - y0 + h20 * y1; h[4] = y3 - y0 + h21 * y3; h[5] = y0;
+		h[6] = h20;                h[7] = h21;                h[8] = 1.0f;
+	}
+
+	// Inverse of SquareToQuad: maps the quad back onto the unit square.
+	// Returns false for a degenerate (collinear / self-intersecting to a line) quad.
+	static inline bool QuadToSquare(const Float2* q, float* h) {
+		float s2q[9];
+		SquareToQuad(q, s2q);
+		const float det = Mat3Adjugate(s2q, h);
+		if (fabsf(det) < 1e-12f) return false;
+		Mat3Normalize(h);
+		return true;
+	}
+}
+
+// --- WORKER POOL (FelinaParallel.cpp) ---
+// Runs body(i) for every i in [0, count) on the shared worker threads; the calling thread
+// takes part and the call returns when all items are done. Nested or concurrent calls
+// run serially on the caller instead of blocking.
+void ParallelFor(int count, const std::function<void(int)>& body);
+
+// Threads that ParallelFor spreads work over (workers + caller)
+int GetParallelism();
+
+// --- HALF FLOAT (FelinaHalf.cpp) ---
+// count IEEE binary16 values <-> float32 (4 per ARGBHalf texel), round to nearest even
+void HalfToFloatRow(const unsigned short* src, float* dst, int count);
+void FloatToHalfRow(const float* src, unsigned short* dst, int count);
+
+// --- REFERENCE CACHE (FelinaReference.cpp) ---
+// Everything derived from a reference texture alone, built once by PrepareReference and
+// shared read-only by every capture of that page.
+struct ReferenceRegion {
+	int x0, y0, x1, y1;                  // Bounding box, x1 / y1 exclusive
+	int area;                            // Pixels
+};
+
+struct ReferencePage {
+	int width, height;
+	float lineThreshold;                 // Luma threshold the mask was built with
+	std::vector<unsigned char> lineMask; // 255 on outline pixels, 0 elsewhere
+	std::vector<float> distance;         // Euclidean distance to the nearest outline pixel
+	std::vector<int> regionMap;          // 4-connected areas between outlines: 1..regions.size(), 0 on outlines
+	std::vector<ReferenceRegion> regions; // regions[id - 1], numbered in raster order of their first pixel
+};
+
+// Cached page for name, or null if it was never prepared (or has been released)
+std::shared_ptr<const ReferencePage> FindReference(const char* name);
@@ -0,0 +1,218 @@
+// Felina UV gutter
+// Pads the UV islands of a model texture so mip filtering along seams averages island
+// colour instead of whatever lies outside (camera black). The islands depend only on the
+// prefab's mesh, so coverage is rasterised from the UV triangles once and the band around
+// it is split into rings by 8-neighbour distance, each texel keeping a mask of its already
+// filled neighbours. Per frame, ring after ring, every band texel becomes the average of
+// those neighbours: only the band is touched, never the rest of the texture.
+
+#include <algorithm>
+#include <vector>
+
+#include "FelinaCommon.h"
+
+// --- INTERNAL HELPERS ---
+
+static const int GUTTER_DEFAULT_PADDING = 8;   // Texels; covers the seams down to the 1/8 mip
+static const int GUTTER_MAX_PADDING = 64;
+static const int GUTTER_MAX_SIZE = 16384;      // Texel coordinates are stored in 16 bits
+static const int GUTTER_CHUNK = 2048;          // Ring texels per worker task
+
+// Neighbour order of the masks: dx, dy
+static const int GUTTER_DX[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+static const int GUTTER_DY[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+
+struct GutterTexel {
+	unsigned short x, y;
+	unsigned char neighbours;                  // Bit k: neighbour k is covered or in an inner ring
+	unsigned char count;                       // Set bits of neighbours
+};
+
+struct UvGutter {
+	int width, height;
+	std::vector<GutterTexel> texels;           // Ring after ring, raster order inside a ring
+	std::vector<int> ringStart;                // Ring k is texels[ringStart[k - 1], ringStart[k])
+};
+
+// Marks the texels whose centre lies inside the triangle (either winding, edges inclusive)
+static void RasterizeTriangle(const float* a, const float* b, const float* c, int width, int height,
+	unsigned char* level) {
+	const float ax = a[0] * width, ay = a[1] * height;
+	const float bx = b[0] * width, by = b[1] * height;
+	const float cx = c[0] * width, cy = c[1] * height;
+	const float area = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+	if (area == 0.0f || area != area) return;
+	const float sign = area > 0.0f ? 1.0f : -1.0f;
+
+	// 1. Texel bounding box, clipped to the texture
+	const float minX = fminf(ax, fminf(bx, cx)), maxX = fmaxf(ax, fmaxf(bx, cx));
+	const float minY = fminf(ay, fminf(by, cy)), maxY = fmaxf(ay, fmaxf(by, cy));
+	const int x0 = (int)fmaxf(floorf(minX - 0.5f), 0.0f), x1 = (int)fminf(ceilf(maxX - 0.5f), (float)(width - 1));
+	const int y0 = (int)fmaxf(floorf(minY - 0.5f), 0.0f), y1 = (int)fminf(ceilf(maxY - 0.5f), (float)(height - 1));
+
+	// 2. Edge functions at texel centres
+	for (int y = y0; y <= y1; y++) {
+		const float py = y + 0.5f;
+		unsigned char* row = level + (size_t)y * width;
+		for (int x = x0; x <= x1; x++) {
+			const float px = x + 0.5f;
+			const float e0 = ((bx - ax) * (py - ay) - (by - ay) * (px - ax)) * sign;
+			const float e1 = ((cx - bx) * (py - by) - (cy - by) * (px - bx)) * sign;
+			const float e2 = ((ax - cx) * (py - cy) - (ay - cy) * (px - cx)) * sign;
+			if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f) row[x] = 1;
+		}
+	}
+}
+
+// Average of the masked neighbours of one texel (offsets in bytes), written over it
+static inline void AverageNeighbours(unsigned char* p, const ptrdiff_t* offsets, int mask, float scale) {
+#if defined(FELINA_SSE)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = zero;
+	for (int k = 0; k < 8; k++) {
+		if (!(mask >> k & 1)) continue;
+		int v;
+		memcpy(&v, p + offsets[k], 4);
+		sum = _mm_add_epi16(sum, _mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero));
+	}
+	const __m128 f = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(sum, zero)), _mm_set1_ps(scale)),
+		_mm_set1_ps(0.5f));
+	__m128i r = _mm_cvttps_epi32(f);
+	r = _mm_packs_epi32(r, r);
+	const int out = _mm_cvtsi128_si32(_mm_packus_epi16(r, r));
+	memcpy(p, &out, 4);
+#elif defined(FELINA_NEON)
+	uint16x8_t sum = vdupq_n_u16(0);
+	for (int k = 0; k < 8; k++) {
+		if (!(mask >> k & 1)) continue;
+		uint32_t v;
+		memcpy(&v, p + offsets[k], 4);
+		sum = vaddw_u8(sum, vreinterpret_u8_u32(vdup_n_u32(v)));
+	}
+	const float32x4_t f = vmlaq_n_f32(vdupq_n_f32(0.5f), vcvtq_f32_u32(vmovl_u16(vget_low_u16(sum))), scale);
+	const uint16x4_t r16 = vmovn_u32(vcvtq_u32_f32(f));
+	const uint8x8_t r8 = vmovn_u16(vcombine_u16(r16, r16));
+	vst1_lane_u32((uint32_t*)(void*)p, vreinterpret_u32_u8(r8), 0);
+#else
+	int sum[4] = { 0, 0, 0, 0 };
+	for (int k = 0; k < 8; k++) {
+		if (!(mask >> k & 1)) continue;
+		const unsigned char* q = p + offsets[k];
+		sum[0] += q[0]; sum[1] += q[1]; sum[2] += q[2]; sum[3] += q[3];
+	}
+	for (int c = 0; c < 4; c++) p[c] = (unsigned char)(int)(sum[c] * scale + 0.5f);
+#endif
+}
+
+extern "C" {
+
+	// --- STEP 25: UV GUTTER DILATION ---
+	// Precomputes the gutter of a prefab's model texture (width x height texels) from its UV
+	// triangles: uvs = vertexCount x (u, v), triangles = indexCount vertex indices (3 per
+	// triangle). Texel row 0 is v = 0, as in Unity texture data; UVs outside 0..1 are clipped.
+	// padding: gutter width in texels (<= 0 selects 8, at most 64). Build once per prefab.
+	EXPORT_API void* CreateUvGutter(float* uvs, int vertexCount, int* triangles, int indexCount,
+		int width, int height, int padding) {
+		if (!uvs || !triangles || vertexCount < 1 || indexCount < 3) return nullptr;
+		if (width < 1 || height < 1 || width > GUTTER_MAX_SIZE || height > GUTTER_MAX_SIZE) return nullptr;
+		if (padding <= 0) padding = GUTTER_DEFAULT_PADDING;
+		if (padding > GUTTER_MAX_PADDING) padding = GUTTER_MAX_PADDING;
+
+		// 1. Coverage: level 1 = inside an island, 0 = not reached yet, k + 1 = ring k
+		std::vector<unsigned char> level((size_t)width * height, 0);
+		for (int i = 0; i + 2 < indexCount; i += 3) {
+			const int a = triangles[i], b = triangles[i + 1], c = triangles[i + 2];
+			if (a < 0 || b < 0 || c < 0 || a >= vertexCount || b >= vertexCount || c >= vertexCount) continue;
+			RasterizeTriangle(uvs + (size_t)a * 2, uvs + (size_t)b * 2, uvs + (size_t)c * 2, width, height, level.data());
+		}
+
+		// 2. Rings by breadth-first growth: ring 1 from a full scan, ring k from ring k - 1
+		UvGutter* g = new UvGutter();
+		g->width = width;
+		g->height = height;
+		std::vector<int> ring, next;
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				if (level[(size_t)y * width + x]) continue;
+				for (int k = 0; k < 8; k++) {
+					const int nx = x + GUTTER_DX[k], ny = y + GUTTER_DY[k];
+					if (nx < 0 || ny < 0 || nx >= width || ny >= height || level[(size_t)ny * width + nx] != 1) continue;
+					ring.push_back(y * width + x);
+					break;
+				}
+			}
+		}
+		for (int r = 1; r <= padding && !ring.empty(); r++) {
+			for (size_t i = 0; i < ring.size(); i++) level[ring[i]] = (unsigned char)(r + 1);
+
+			// 3. Neighbour masks: covered texels and inner rings (levels 1..r)
+			for (size_t i = 0; i < ring.size(); i++) {
+				const int x = ring[i] % width, y = ring[i] / width;
+				GutterTexel t = { (unsigned short)x, (unsigned short)y, 0, 0 };
+				for (int k = 0; k < 8; k++) {
+					const int nx = x + GUTTER_DX[k], ny = y + GUTTER_DY[k];
+					if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+					const int l = level[(size_t)ny * width + nx];
+					if (l < 1 || l > r) continue;
+					t.neighbours |= (unsigned char)(1 << k);
+					t.count++;
+				}
+				g->texels.push_back(t);
+			}
+			g->ringStart.push_back((int)g->texels.size());
+			if (r == padding) break;
+
+			// 4. Next ring: unreached neighbours of this one, in raster order
+			next.clear();
+			for (size_t i = 0; i < ring.size(); i++) {
+				const int x = ring[i] % width, y = ring[i] / width;
+				for (int k = 0; k < 8; k++) {
+					const int nx = x + GUTTER_DX[k], ny = y + GUTTER_DY[k];
+					if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+					unsigned char& l = level[(size_t)ny * width + nx];
+					if (l) continue;
+					l = 255;                   // Queued
+					next.push_back(ny * width + nx);
+				}
+			}
+			std::sort(next.begin(), next.end());
+			ring.swap(next);
+		}
+		return g;
+	}
+
+	EXPORT_API void DestroyUvGutter(void* gutter) {
+		delete (UvGutter*)gutter;
+	}
+
+	// Fills the gutter of an RGBA8 texture of the gutter's size in place (stride in bytes,
+	// 0 = packed), alpha included. Island texels and texels beyond the padding are not touched.
+	EXPORT_API bool DilateUvGutter(void* gutter, unsigned char* rgba, int stride) {
+		const UvGutter* g = (const UvGutter*)gutter;
+		if (!g || !rgba) return false;
+		if (stride <= 0) stride = g->width * 4;
+
+		ptrdiff_t offsets[8];
+		for (int k = 0; k < 8; k++) offsets[k] = (ptrdiff_t)GUTTER_DY[k] * stride + GUTTER_DX[k] * 4;
+		float scale[9] = { 0.0f };
+		for (int n = 1; n <= 8; n++) scale[n] = 1.0f / n;
+
+		// Rings in order (each reads the ones inside it), texels of a ring in parallel
+		int begin = 0;
+		for (size_t r = 0; r < g->ringStart.size(); r++) {
+			const int end = g->ringStart[r];
+			const GutterTexel* texels = g->texels.data() + begin;
+			const int count = end - begin;
+			const int chunks = (count + GUTTER_CHUNK - 1) / GUTTER_CHUNK;
+			ParallelFor(chunks, [texels, count, rgba, stride, &offsets, &scale](int c) {
+				const int i1 = (c + 1) * GUTTER_CHUNK < count ? (c + 1) * GUTTER_CHUNK : count;
+				for (int i = c * GUTTER_CHUNK; i < i1; i++) {
+					const GutterTexel& t = texels[i];
+					AverageNeighbours(rgba + (size_t)t.y * stride + (size_t)t.x * 4, offsets, t.neighbours, scale[t.count]);
+				}
+			});
+			begin = end;
+		}
+		return true;
+	}
+}
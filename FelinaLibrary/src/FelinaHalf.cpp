@@ -0,0 +1,182 @@
+// Felina half-float conversion
+// ARGBHalf is the default render texture format, so the CPU kernels read and write IEEE 754
+// binary16 RGBA directly instead of staging whole frames as float32. x86 uses F16C, detected
+// at runtime because it is not part of the SSE2 baseline; arm64 uses the FCVTL/FCVTN
+// conversions every ARMv8 core has (the ARMv8.2 FP16 extension only adds half arithmetic,
+// which nothing here needs). The scalar fallback is bit-exact with both: round to nearest
+// even, subnormals and infinities preserved, NaNs quieted.
+
+#include "FelinaCommon.h"
+
+#if defined(FELINA_SSE)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define FELINA_F16C_TARGET
+#else
+#include <cpuid.h>
+#define FELINA_F16C_TARGET __attribute__((target("f16c")))
+#endif
+#endif
+
+// --- INTERNAL HELPERS ---
+
+static const int HALF_PARALLEL_CHUNK = 1 << 16; // Values per worker task
+
+static inline float HalfToFloatScalar(unsigned short h) {
+	const unsigned int sign = (unsigned int)(h & 0x8000) << 16;
+	const unsigned int exp = (h >> 10) & 0x1F, mant = h & 0x3FF;
+	unsigned int bits;
+	if (exp == 0x1F) bits = sign | 0x7F800000u | (mant ? 0x400000u | (mant << 13) : 0); // Inf / NaN (quieted)
+	else if (exp != 0) bits = sign | ((exp + 112) << 23) | (mant << 13);
+	else if (mant == 0) bits = sign;                                  // +-0
+	else {
+		// Subnormal: mant * 2^-24, exact in float
+		const float v = mant * (1.0f / 16777216.0f);
+		memcpy(&bits, &v, 4);
+		bits |= sign;
+	}
+	float f;
+	memcpy(&f, &bits, 4);
+	return f;
+}
+
+static inline unsigned short FloatToHalfScalar(float f) {
+	unsigned int bits;
+	memcpy(&bits, &f, 4);
+	const unsigned short sign = (unsigned short)((bits >> 16) & 0x8000);
+	const unsigned int exp = (bits >> 23) & 0xFF;
+	unsigned int mant = bits & 0x7FFFFF;
+
+	// 1. Inf / NaN (quiet bit kept)
+	if (exp == 0xFF) return (unsigned short)(sign | 0x7C00 | (mant ? 0x200 | (mant >> 13) : 0));
+
+	// 2. Overflow to infinity
+	const int e = (int)exp - 112;
+	if (e >= 31) return (unsigned short)(sign | 0x7C00);
+
+	// 3. Normal: drop 13 mantissa bits, round to nearest even (a carry may bump the exponent)
+	if (e > 0) {
+		unsigned int h = ((unsigned int)e << 10) | (mant >> 13);
+		const unsigned int rest = mant & 0x1FFF;
+		if (rest > 0x1000 || (rest == 0x1000 && (h & 1))) h++;
+		return (unsigned short)(sign | h);
+	}
+
+	// 4. Subnormal or zero: shift the implicit bit in, round to nearest even
+	if (e < -10) return sign;
+	mant |= 0x800000;
+	const int shift = 14 - e;
+	unsigned int h = mant >> shift;
+	const unsigned int rest = mant & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+	if (rest > halfway || (rest == halfway && (h & 1))) h++;
+	return (unsigned short)(sign | h);
+}
+
+#if defined(FELINA_SSE)
+// F16C needs the CPU flag and the OS saving the AVX (VEX) register state
+static bool DetectF16C() {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	const unsigned int ecx = (unsigned int)info[2];
+#else
+	unsigned int eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+#endif
+	const unsigned int need = (1u << 29) | (1u << 28) | (1u << 27); // F16C, AVX, OSXSAVE
+	if ((ecx & need) != need) return false;
+#if defined(_MSC_VER)
+	return (_xgetbv(0) & 6) == 6;
+#else
+	unsigned int lo, hi;
+	__asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return (lo & 6) == 6;
+#endif
+}
+
+static bool HasF16C() {
+	static const bool has = DetectF16C();
+	return has;
+}
+
+FELINA_F16C_TARGET static void HalfToFloatF16C(const unsigned short* src, float* dst, int count) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m128i h = _mm_loadu_si128((const __m128i*)(src + i));
+		_mm_storeu_ps(dst + i, _mm_cvtph_ps(h));
+		_mm_storeu_ps(dst + i + 4, _mm_cvtph_ps(_mm_unpackhi_epi64(h, h)));
+	}
+	for (; i + 4 <= count; i += 4) _mm_storeu_ps(dst + i, _mm_cvtph_ps(_mm_loadl_epi64((const __m128i*)(src + i))));
+	for (; i < count; i++) dst[i] = HalfToFloatScalar(src[i]);
+}
+
+FELINA_F16C_TARGET static void FloatToHalfF16C(const float* src, unsigned short* dst, int count) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m128i lo = _mm_cvtps_ph(_mm_loadu_ps(src + i), 0);  // 0 = round to nearest even
+		const __m128i hi = _mm_cvtps_ph(_mm_loadu_ps(src + i + 4), 0);
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi64(lo, hi));
+	}
+	for (; i + 4 <= count; i += 4) _mm_storel_epi64((__m128i*)(dst + i), _mm_cvtps_ph(_mm_loadu_ps(src + i), 0));
+	for (; i < count; i++) dst[i] = FloatToHalfScalar(src[i]);
+}
+#endif
+
+// --- ROW CONVERSION (declared in FelinaCommon.h) ---
+
+void HalfToFloatRow(const unsigned short* src, float* dst, int count) {
+	int i = 0;
+#if defined(FELINA_SSE)
+	if (HasF16C()) { HalfToFloatF16C(src, dst, count); return; }
+#elif defined(FELINA_NEON)
+	for (; i + 8 <= count; i += 8) {
+		const uint16x8_t h = vld1q_u16(src + i);
+		vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vget_low_u16(h))));
+		vst1q_f32(dst + i + 4, vcvt_f32_f16(vreinterpret_f16_u16(vget_high_u16(h))));
+	}
+#endif
+	for (; i < count; i++) dst[i] = HalfToFloatScalar(src[i]);
+}
+
+void FloatToHalfRow(const float* src, unsigned short* dst, int count) {
+	int i = 0;
+#if defined(FELINA_SSE)
+	if (HasF16C()) { FloatToHalfF16C(src, dst, count); return; }
+#elif defined(FELINA_NEON)
+	for (; i + 8 <= count; i += 8) {
+		const float16x4_t lo = vcvt_f16_f32(vld1q_f32(src + i));
+		const float16x4_t hi = vcvt_f16_f32(vld1q_f32(src + i + 4));
+		vst1q_u16(dst + i, vcombine_u16(vreinterpret_u16_f16(lo), vreinterpret_u16_f16(hi)));
+	}
+#endif
+	for (; i < count; i++) dst[i] = FloatToHalfScalar(src[i]);
+}
+
+extern "C" {
+
+	// --- STEP 15: HALF-FLOAT CONVERSION ---
+	// count values (4 per ARGBHalf texel) between IEEE binary16 and float32, round to nearest
+	// even. Large buffers are split over the worker pool.
+	EXPORT_API bool HalfToFloat(unsigned short* src, float* dst, int count) {
+		if (!src || !dst || count < 0) return false;
+		const int chunks = (count + HALF_PARALLEL_CHUNK - 1) / HALF_PARALLEL_CHUNK;
+		ParallelFor(chunks, [src, dst, count](int c) {
+			const int i0 = c * HALF_PARALLEL_CHUNK;
+			const int n = count - i0 < HALF_PARALLEL_CHUNK ? count - i0 : HALF_PARALLEL_CHUNK;
+			HalfToFloatRow(src + i0, dst + i0, n);
+		});
+		return true;
+	}
+
+	EXPORT_API bool FloatToHalf(float* src, unsigned short* dst, int count) {
+		if (!src || !dst || count < 0) return false;
+		const int chunks = (count + HALF_PARALLEL_CHUNK - 1) / HALF_PARALLEL_CHUNK;
+		ParallelFor(chunks, [src, dst, count](int c) {
+			const int i0 = c * HALF_PARALLEL_CHUNK;
+			const int n = count - i0 < HALF_PARALLEL_CHUNK ? count - i0 : HALF_PARALLEL_CHUNK;
+			FloatToHalfRow(src + i0, dst + i0, n);
+		});
+		return true;
+	}
+}
@@ -0,0 +1,326 @@
+// Felina integral images
+// Summed-area tables for O(1) box statistics (local white point, occlusion checks, ROI
+// brightness, per-region means). Built in two passes: a SIMD prefix sum along each row
+// (rows in parallel) and a vertical accumulation over column strips (strips in parallel).
+// Sums are kept in 32 bits with wrap-around: a box sum is a difference of four corners, so
+// it is exact modulo 2^32 and therefore exact for any box up to 2^32 / 255 pixels (16.8 MP).
+// Squared sums do not have that headroom and are kept in 64 bits.
+
+#include <vector>
+
+#include "FelinaCommon.h"
+
+// --- INTERNAL HELPERS ---
+
+static const int INTEGRAL_ROW_TASK = 16;        // Rows per worker task in the row pass
+static const int INTEGRAL_COLUMN_STRIP = 1024;  // Table entries per worker task in the column pass
+
+struct IntegralImage {
+	int width, height;
+	int channels;                   // 1 (luma / mask) or 4 (RGBA8)
+	int stride;                     // Entries per table row: (width + 1) * channels
+	std::vector<unsigned int> sum;  // (height + 1) rows, leading zero row and column
+	std::vector<unsigned long long> sq; // Same layout, empty unless squares were requested
+};
+
+// Inclusive prefix sums of one single-channel row into out[1..width] (out[0] = 0)
+static void PrefixRow1(const unsigned char* src, int width, unsigned int* out) {
+	out[0] = 0;
+	out++;
+	int x = 0;
+	unsigned int run = 0;
+#if defined(FELINA_SSE)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i carry = zero;
+	for (; x + 16 <= width; x += 16) {
+		const __m128i v8 = _mm_loadu_si128((const __m128i*)(src + x));
+		const __m128i lo = _mm_unpacklo_epi8(v8, zero), hi = _mm_unpackhi_epi8(v8, zero);
+		const __m128i quads[4] = {
+			_mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+			_mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)
+		};
+		for (int q = 0; q < 4; q++) {
+			// Log-step scan of 4 lanes, then add the running total
+			__m128i v = quads[q];
+			v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+			v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+			v = _mm_add_epi32(v, carry);
+			_mm_storeu_si128((__m128i*)(out + x + q * 4), v);
+			carry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+		}
+	}
+	run = (unsigned int)_mm_cvtsi128_si32(carry);
+#elif defined(FELINA_NEON)
+	const uint32x4_t zero = vdupq_n_u32(0);
+	uint32x4_t carry = zero;
+	for (; x + 16 <= width; x += 16) {
+		const uint8x16_t v8 = vld1q_u8(src + x);
+		const uint16x8_t lo = vmovl_u8(vget_low_u8(v8)), hi = vmovl_u8(vget_high_u8(v8));
+		const uint32x4_t quads[4] = {
+			vmovl_u16(vget_low_u16(lo)), vmovl_u16(vget_high_u16(lo)),
+			vmovl_u16(vget_low_u16(hi)), vmovl_u16(vget_high_u16(hi))
+		};
+		for (int q = 0; q < 4; q++) {
+			uint32x4_t v = quads[q];
+			v = vaddq_u32(v, vextq_u32(zero, v, 3));
+			v = vaddq_u32(v, vextq_u32(zero, v, 2));
+			v = vaddq_u32(v, carry);
+			vst1q_u32(out + x + q * 4, v);
+			carry = vdupq_laneq_u32(v, 3);
+		}
+	}
+	run = vgetq_lane_u32(carry, 0);
+#endif
+	for (; x < width; x++) out[x] = run += src[x];
+}
+
+// Inclusive per-channel prefix sums of one RGBA8 row (the 4 channels are the SIMD lanes)
+static void PrefixRow4(const unsigned char* src, int width, unsigned int* out) {
+	out[0] = out[1] = out[2] = out[3] = 0;
+	out += 4;
+	int x = 0;
+	unsigned int run[4] = { 0, 0, 0, 0 };
+#if defined(FELINA_SSE)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i carry = zero;
+	for (; x + 4 <= width; x += 4) {
+		const __m128i v8 = _mm_loadu_si128((const __m128i*)(src + x * 4));
+		const __m128i lo = _mm_unpacklo_epi8(v8, zero), hi = _mm_unpackhi_epi8(v8, zero);
+		carry = _mm_add_epi32(carry, _mm_unpacklo_epi16(lo, zero));
+		_mm_storeu_si128((__m128i*)(out + x * 4), carry);
+		carry = _mm_add_epi32(carry, _mm_unpackhi_epi16(lo, zero));
+		_mm_storeu_si128((__m128i*)(out + x * 4 + 4), carry);
+		carry = _mm_add_epi32(carry, _mm_unpacklo_epi16(hi, zero));
+		_mm_storeu_si128((__m128i*)(out + x * 4 + 8), carry);
+		carry = _mm_add_epi32(carry, _mm_unpackhi_epi16(hi, zero));
+		_mm_storeu_si128((__m128i*)(out + x * 4 + 12), carry);
+	}
+	_mm_storeu_si128((__m128i*)run, carry);
+#elif defined(FELINA_NEON)
+	uint32x4_t carry = vdupq_n_u32(0);
+	for (; x + 4 <= width; x += 4) {
+		const uint8x16_t v8 = vld1q_u8(src + x * 4);
+		const uint16x8_t lo = vmovl_u8(vget_low_u8(v8)), hi = vmovl_u8(vget_high_u8(v8));
+		carry = vaddw_u16(carry, vget_low_u16(lo));
+		vst1q_u32(out + x * 4, carry);
+		carry = vaddw_u16(carry, vget_high_u16(lo));
+		vst1q_u32(out + x * 4 + 4, carry);
+		carry = vaddw_u16(carry, vget_low_u16(hi));
+		vst1q_u32(out + x * 4 + 8, carry);
+		carry = vaddw_u16(carry, vget_high_u16(hi));
+		vst1q_u32(out + x * 4 + 12, carry);
+	}
+	vst1q_u32(run, carry);
+#endif
+	for (; x < width; x++)
+		for (int c = 0; c < 4; c++) out[x * 4 + c] = run[c] += src[x * 4 + c];
+}
+
+// Squared prefix sums (64-bit) of one row. Squares fit 16 bits, so they are formed in 16-bit
+// lanes and widened; 1 channel scans pairs, 4 channels carry two 64-bit lanes each.
+static void PrefixRowSquares(const unsigned char* src, int width, int channels, unsigned long long* out) {
+	unsigned long long run[4] = { 0, 0, 0, 0 };
+	for (int c = 0; c < channels; c++) out[c] = 0;
+	out += channels;
+	const int values = width * channels;
+	int i = 0;
+#if defined(FELINA_SSE)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i carry01 = zero, carry23 = zero;
+	for (; i + 8 <= values; i += 8) {
+		const __m128i v16 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(src + i)), zero);
+		const __m128i sq16 = _mm_mullo_epi16(v16, v16);
+		const __m128i sq32[2] = { _mm_unpacklo_epi16(sq16, zero), _mm_unpackhi_epi16(sq16, zero) };
+		for (int h = 0; h < 2; h++) {
+			const __m128i lo = _mm_unpacklo_epi32(sq32[h], zero), hi = _mm_unpackhi_epi32(sq32[h], zero);
+			__m128i* dst = (__m128i*)(out + i + h * 4);
+			if (channels == 4) {
+				carry01 = _mm_add_epi64(carry01, lo);
+				carry23 = _mm_add_epi64(carry23, hi);
+				_mm_storeu_si128(dst, carry01);
+				_mm_storeu_si128(dst + 1, carry23);
+			}
+			else {
+				// carry01 holds the running total in both lanes
+				const __m128i a = _mm_add_epi64(_mm_add_epi64(lo, _mm_slli_si128(lo, 8)), carry01);
+				carry01 = _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 2, 3, 2));
+				const __m128i b = _mm_add_epi64(_mm_add_epi64(hi, _mm_slli_si128(hi, 8)), carry01);
+				carry01 = _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 2, 3, 2));
+				_mm_storeu_si128(dst, a);
+				_mm_storeu_si128(dst + 1, b);
+			}
+		}
+	}
+	if (i) {
+		if (channels == 4) {
+			_mm_storeu_si128((__m128i*)run, carry01);
+			_mm_storeu_si128((__m128i*)(run + 2), carry23);
+		}
+		else run[0] = out[i - 1];
+	}
+#elif defined(FELINA_NEON)
+	const uint64x2_t zero = vdupq_n_u64(0);
+	uint64x2_t carry01 = zero, carry23 = zero;
+	for (; i + 8 <= values; i += 8) {
+		const uint8x8_t v8 = vld1_u8(src + i);
+		const uint16x8_t sq16 = vmull_u8(v8, v8);
+		const uint32x4_t sq32[2] = { vmovl_u16(vget_low_u16(sq16)), vmovl_u16(vget_high_u16(sq16)) };
+		for (int h = 0; h < 2; h++) {
+			const uint64x2_t lo = vmovl_u32(vget_low_u32(sq32[h])), hi = vmovl_u32(vget_high_u32(sq32[h]));
+			unsigned long long* dst = out + i + h * 4;
+			if (channels == 4) {
+				carry01 = vaddq_u64(carry01, lo);
+				carry23 = vaddq_u64(carry23, hi);
+				vst1q_u64(dst, carry01);
+				vst1q_u64(dst + 2, carry23);
+			}
+			else {
+				const uint64x2_t a = vaddq_u64(vaddq_u64(lo, vextq_u64(zero, lo, 1)), carry01);
+				carry01 = vdupq_laneq_u64(a, 1);
+				const uint64x2_t b = vaddq_u64(vaddq_u64(hi, vextq_u64(zero, hi, 1)), carry01);
+				carry01 = vdupq_laneq_u64(b, 1);
+				vst1q_u64(dst, a);
+				vst1q_u64(dst + 2, b);
+			}
+		}
+	}
+	if (i) {
+		if (channels == 4) {
+			vst1q_u64(run, carry01);
+			vst1q_u64(run + 2, carry23);
+		}
+		else run[0] = out[i - 1];
+	}
+#endif
+	for (; i < values; i++) {
+		const unsigned int v = src[i];
+		out[i] = run[i % channels] += v * v;
+	}
+}
+
+// dst[i] += src[i] for the column pass
+static void AddRow(const unsigned int* src, unsigned int* dst, int count) {
+	int i = 0;
+#if defined(FELINA_SSE)
+	for (; i + 4 <= count; i += 4) {
+		const __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi32(a, _mm_loadu_si128((const __m128i*)(dst + i))));
+	}
+#elif defined(FELINA_NEON)
+	for (; i + 4 <= count; i += 4) vst1q_u32(dst + i, vaddq_u32(vld1q_u32(src + i), vld1q_u32(dst + i)));
+#endif
+	for (; i < count; i++) dst[i] += src[i];
+}
+
+static void AddRow(const unsigned long long* src, unsigned long long* dst, int count) {
+	int i = 0;
+#if defined(FELINA_SSE)
+	for (; i + 2 <= count; i += 2) {
+		const __m128i a = _mm_loadu_si128((const __m128i*)(src + i));
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi64(a, _mm_loadu_si128((const __m128i*)(dst + i))));
+	}
+#elif defined(FELINA_NEON)
+	for (; i + 2 <= count; i += 2) vst1q_u64(dst + i, vaddq_u64(vld1q_u64(src + i), vld1q_u64(dst + i)));
+#endif
+	for (; i < count; i++) dst[i] += src[i];
+}
+
+// Vertical accumulation of a row-prefixed table, one strip of columns per task
+template <typename T>
+static void AccumulateColumns(T* table, int stride, int rows) {
+	const int strips = (stride + INTEGRAL_COLUMN_STRIP - 1) / INTEGRAL_COLUMN_STRIP;
+	ParallelFor(strips, [table, stride, rows](int s) {
+		const int i0 = s * INTEGRAL_COLUMN_STRIP;
+		const int n = stride - i0 < INTEGRAL_COLUMN_STRIP ? stride - i0 : INTEGRAL_COLUMN_STRIP;
+		for (int y = 2; y <= rows; y++)
+			AddRow(table + (size_t)(y - 1) * stride + i0, table + (size_t)y * stride + i0, n);
+	});
+}
+
+extern "C" {
+
+	// --- STEP 19: INTEGRAL IMAGE ---
+	// Summed-area table for width x height images with 1 (8-bit luma / mask) or 4 (RGBA8)
+	// channels. squares != 0 also keeps 64-bit squared sums for variance queries.
+	// The table is reused across captures: create once, BuildIntegralImage per frame.
+	EXPORT_API void* CreateIntegralImage(int width, int height, int channels, int squares) {
+		if (width < 1 || height < 1 || (channels != 1 && channels != 4)) return nullptr;
+		IntegralImage* sat = new IntegralImage();
+		sat->width = width;
+		sat->height = height;
+		sat->channels = channels;
+		sat->stride = (width + 1) * channels;
+		const size_t entries = (size_t)sat->stride * (height + 1);
+		sat->sum.assign(entries, 0);
+		if (squares) sat->sq.assign(entries, 0);
+		return sat;
+	}
+
+	EXPORT_API void DestroyIntegralImage(void* sat) {
+		delete (IntegralImage*)sat;
+	}
+
+	// pixels: width x height of the table's channel count, stride in bytes (0 = packed)
+	EXPORT_API bool BuildIntegralImage(void* handle, unsigned char* pixels, int stride) {
+		IntegralImage* sat = (IntegralImage*)handle;
+		if (!sat || !pixels) return false;
+		const int w = sat->width, h = sat->height, ch = sat->channels;
+		if (stride <= 0) stride = w * ch;
+		const bool squares = !sat->sq.empty();
+
+		// 1. Row prefix sums into rows 1..height (row 0 stays zero)
+		const int tasks = (h + INTEGRAL_ROW_TASK - 1) / INTEGRAL_ROW_TASK;
+		ParallelFor(tasks, [sat, pixels, stride, w, h, ch, squares](int t) {
+			const int y0 = t * INTEGRAL_ROW_TASK;
+			const int y1 = y0 + INTEGRAL_ROW_TASK < h ? y0 + INTEGRAL_ROW_TASK : h;
+			for (int y = y0; y < y1; y++) {
+				const unsigned char* src = pixels + (size_t)y * stride;
+				unsigned int* out = &sat->sum[(size_t)(y + 1) * sat->stride];
+				if (ch == 1) PrefixRow1(src, w, out);
+				else PrefixRow4(src, w, out);
+				if (squares) PrefixRowSquares(src, w, ch, &sat->sq[(size_t)(y + 1) * sat->stride]);
+			}
+		});
+
+		// 2. Column pass
+		AccumulateColumns(sat->sum.data(), sat->stride, h);
+		if (squares) AccumulateColumns(sat->sq.data(), sat->stride, h);
+		return true;
+	}
+
+	// rects: count x (x, y, width, height) in pixels, clipped to the image.
+	// mean / variance: count x channels values in 0..1 units (variance optional, needs squares).
+	// Empty boxes report 0.
+	EXPORT_API bool IntegralRectStats(void* handle, int* rects, int count, float* mean, float* variance) {
+		const IntegralImage* sat = (const IntegralImage*)handle;
+		if (!sat || !rects || !mean || count < 0) return false;
+		if (variance && sat->sq.empty()) return false;
+		const int ch = sat->channels, stride = sat->stride;
+
+		for (int i = 0; i < count; i++) {
+			const int* r = rects + i * 4;
+			const int x0 = r[0] < 0 ? 0 : (r[0] > sat->width ? sat->width : r[0]);
+			const int y0 = r[1] < 0 ? 0 : (r[1] > sat->height ? sat->height : r[1]);
+			const int x1 = r[0] + r[2] < x0 ? x0 : (r[0] + r[2] > sat->width ? sat->width : r[0] + r[2]);
+			const int y1 = r[1] + r[3] < y0 ? y0 : (r[1] + r[3] > sat->height ? sat->height : r[1] + r[3]);
+			const double area = (double)(x1 - x0) * (y1 - y0);
+
+			// Corner offsets: A (x0, y0), B (x1, y0), C (x0, y1), D (x1, y1)
+			const size_t a = (size_t)y0 * stride + (size_t)x0 * ch, b = (size_t)y0 * stride + (size_t)x1 * ch;
+			const size_t c = (size_t)y1 * stride + (size_t)x0 * ch, d = (size_t)y1 * stride + (size_t)x1 * ch;
+			for (int k = 0; k < ch; k++) {
+				float* m = mean + (size_t)i * ch + k;
+				float* v = variance ? variance + (size_t)i * ch + k : nullptr;
+				if (area <= 0.0) { *m = 0.0f; if (v) *v = 0.0f; continue; }
+				const unsigned int s = sat->sum[d + k] - sat->sum[b + k] - sat->sum[c + k] + sat->sum[a + k];
+				const double mu = s / area;
+				*m = (float)(mu * (1.0 / 255.0));
+				if (!v) continue;
+				const unsigned long long q = sat->sq[d + k] - sat->sq[b + k] - sat->sq[c + k] + sat->sq[a + k];
+				const double var = q / area - mu * mu;
+				*v = (float)((var > 0.0 ? var : 0.0) * (1.0 / (255.0 * 255.0)));
+			}
+		}
+		return true;
+	}
+}
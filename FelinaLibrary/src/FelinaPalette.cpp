@@ -0,0 +1,203 @@
+// Felina palette snapping
+// Pulls captured colours back onto the real crayon set. The palette is converted to CIE Lab
+// once and every node of an RGB lattice (32^3 by default) stores its nearest crayon, so a
+// pixel costs a table fetch instead of a search over the palette. Hard snapping reads the
+// nearest node's crayon; soft snapping blends the crayon colours of the 4 nodes of the
+// enclosing tetrahedron, which keeps palette boundaries anti-aliased. Lightness is weighted
+// down in the distance so shading does not flip a crayon into its lighter or darker neighbour.
+
+#include <vector>
+
+#include "FelinaCommon.h"
+
+// --- INTERNAL HELPERS ---
+
+static const int PALETTE_DEFAULT_LUT = 32;
+static const int PALETTE_MAX_LUT = 64;
+static const int PALETTE_MAX_COLORS = 256;       // Indices are stored as bytes
+static const float PALETTE_DEFAULT_LIGHTNESS_WEIGHT = 0.5f;
+static const int PALETTE_BAND_ROWS = 16;
+
+enum {
+	PALETTE_SNAP_NEAREST = 0,
+	PALETTE_SNAP_TETRAHEDRAL = 1
+};
+
+struct PaletteSnapper {
+	int size;                          // Lattice nodes per axis
+	std::vector<unsigned char> index;  // Nearest crayon per node, r fastest, then g, then b
+	std::vector<unsigned int> color;   // That crayon as packed RGBA8 (alpha 255)
+	unsigned char cell[256];           // Channel value -> lower node (0..size - 2)
+	unsigned short frac[256];          // Position inside the cell, 0..256
+	unsigned char nearest[256];        // Channel value -> closest node
+};
+
+static inline float SrgbToLinear(float c) {
+	return c <= 0.04045f ? c * (1.0f / 12.92f) : powf((c + 0.055f) * (1.0f / 1.055f), 2.4f);
+}
+
+static inline float LabF(float t) {
+	return t > 0.008856f ? cbrtf(t) : 7.787f * t + 16.0f / 116.0f;
+}
+
+// sRGB (0..255) -> CIE Lab, D65 white
+static void RgbToLab(float r, float g, float b, float* lab) {
+	r = SrgbToLinear(r * (1.0f / 255.0f));
+	g = SrgbToLinear(g * (1.0f / 255.0f));
+	b = SrgbToLinear(b * (1.0f / 255.0f));
+	const float x = LabF((0.4124f * r + 0.3576f * g + 0.1805f * b) * (1.0f / 0.95047f));
+	const float y = LabF(0.2126f * r + 0.7152f * g + 0.0722f * b);
+	const float z = LabF((0.0193f * r + 0.1192f * g + 0.9505f * b) * (1.0f / 1.08883f));
+	lab[0] = 116.0f * y - 16.0f;
+	lab[1] = 500.0f * (x - y);
+	lab[2] = 200.0f * (y - z);
+}
+
+// Packed RGBA8 blend of 4 lattice colours, weights summing to 256
+static inline unsigned int BlendTetrahedron(unsigned int c0, unsigned int c1, unsigned int c2, unsigned int c3,
+	int w0, int w1, int w2, int w3) {
+#if defined(FELINA_SSE)
+	// madd pairs: (c0, c1) x (w0, w1) + (c2, c3) x (w2, w3) per channel
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c01 = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)c0), _mm_cvtsi32_si128((int)c1)), zero);
+	const __m128i c23 = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int)c2), _mm_cvtsi32_si128((int)c3)), zero);
+	const __m128i w01 = _mm_set1_epi32((w1 << 16) | w0);
+	const __m128i w23 = _mm_set1_epi32((w3 << 16) | w2);
+	__m128i sum = _mm_add_epi32(_mm_madd_epi16(c01, w01), _mm_madd_epi16(c23, w23));
+	sum = _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(128)), 8);
+	sum = _mm_packs_epi32(sum, sum);
+	return (unsigned int)_mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+#elif defined(FELINA_NEON)
+	const uint16x8_t c01 = vmovl_u8(vreinterpret_u8_u32(vset_lane_u32(c1, vdup_n_u32(c0), 1)));
+	const uint16x8_t c23 = vmovl_u8(vreinterpret_u8_u32(vset_lane_u32(c3, vdup_n_u32(c2), 1)));
+	uint32x4_t sum = vmull_n_u16(vget_low_u16(c01), (uint16_t)w0);
+	sum = vmlal_n_u16(sum, vget_high_u16(c01), (uint16_t)w1);
+	sum = vmlal_n_u16(sum, vget_low_u16(c23), (uint16_t)w2);
+	sum = vmlal_n_u16(sum, vget_high_u16(c23), (uint16_t)w3);
+	const uint8x8_t n8 = vqmovn_u16(vcombine_u16(vrshrn_n_u32(sum, 8), vdup_n_u16(0)));
+	return vget_lane_u32(vreinterpret_u32_u8(n8), 0);
+#else
+	unsigned int out = 0;
+	for (int s = 0; s < 32; s += 8) {
+		const int v = ((int)((c0 >> s) & 255) * w0 + (int)((c1 >> s) & 255) * w1 +
+			(int)((c2 >> s) & 255) * w2 + (int)((c3 >> s) & 255) * w3 + 128) >> 8;
+		out |= (unsigned int)(v > 255 ? 255 : v) << s;
+	}
+	return out;
+#endif
+}
+
+// Soft snap of one pixel: the lattice cell is split into 6 tetrahedra along its diagonal and
+// the one holding the pixel follows from the order of the fractional coordinates. The order
+// is looked up from the three comparisons instead of branched on (noisy captures defeat the
+// branch predictor).
+static inline unsigned int SnapTetrahedral(const PaletteSnapper& s, const unsigned char* p) {
+	// (largest axis, smallest axis) per comparison key; keys 3 and 4 cannot occur
+	static const unsigned char ORDER[8][2] = { { 2, 0 }, { 2, 1 }, { 1, 0 }, { 0, 2 }, { 0, 2 }, { 0, 1 }, { 1, 2 }, { 0, 2 } };
+	const int n = s.size;
+	const int stride[3] = { 1, n, n * n };
+	const int f[3] = { s.frac[p[0]], s.frac[p[1]], s.frac[p[2]] };
+	const int key = (f[0] >= f[1]) | ((f[1] >= f[2]) << 1) | ((f[0] >= f[2]) << 2);
+	const int hiAxis = ORDER[key][0], loAxis = ORDER[key][1];
+	const int hi = f[hiAxis], lo = f[loAxis], mid = f[0] + f[1] + f[2] - hi - lo;
+	const unsigned int* c = &s.color[s.cell[p[0]] + s.cell[p[1]] * stride[1] + s.cell[p[2]] * stride[2]];
+	const int diagonal = stride[0] + stride[1] + stride[2];
+	return BlendTetrahedron(c[0], c[stride[hiAxis]], c[diagonal - stride[loAxis]], c[diagonal],
+		256 - hi, hi - mid, mid - lo, lo);
+}
+
+extern "C" {
+
+	// --- STEP 23: PALETTE SNAPPING ---
+	// palette: count x RGBA8 crayon colours (count <= 256). lutSize: lattice nodes per axis
+	// (<= 0 selects 32, at most 64). lightnessWeight scales L in the Lab distance (<= 0
+	// selects 0.5; 1 = plain CIE76). Build once per palette.
+	EXPORT_API void* CreatePaletteSnapper(unsigned char* palette, int count, int lutSize, float lightnessWeight) {
+		if (!palette || count < 1 || count > PALETTE_MAX_COLORS) return nullptr;
+		if (lutSize <= 0) lutSize = PALETTE_DEFAULT_LUT;
+		lutSize = lutSize < 2 ? 2 : (lutSize > PALETTE_MAX_LUT ? PALETTE_MAX_LUT : lutSize);
+		if (lightnessWeight <= 0.0f) lightnessWeight = PALETTE_DEFAULT_LIGHTNESS_WEIGHT;
+
+		PaletteSnapper* s = new PaletteSnapper();
+		const int n = lutSize;
+		s->size = n;
+		s->index.resize((size_t)n * n * n);
+		s->color.resize((size_t)n * n * n);
+
+		// 1. Channel value -> lattice position (node i sits at i * 255 / (n - 1))
+		for (int v = 0; v < 256; v++) {
+			const int pos = v * (n - 1);                 // In units of 1/255 node
+			int cell = pos / 255, rem = pos % 255;
+			if (cell > n - 2) { cell = n - 2; rem = 255; }
+			s->cell[v] = (unsigned char)cell;
+			s->frac[v] = (unsigned short)((rem * 256 + 127) / 255);
+			s->nearest[v] = (unsigned char)((pos + 127) / 255);
+		}
+
+		// 2. Palette in weighted Lab
+		std::vector<float> lab((size_t)count * 3);
+		for (int i = 0; i < count; i++) {
+			const unsigned char* c = palette + i * 4;
+			RgbToLab(c[0], c[1], c[2], &lab[(size_t)i * 3]);
+			lab[(size_t)i * 3] *= lightnessWeight;
+		}
+
+		// 3. Nearest crayon per node, one blue slice per task
+		ParallelFor(n, [s, n, count, palette, lightnessWeight, &lab](int b) {
+			for (int g = 0; g < n; g++) {
+				for (int r = 0; r < n; r++) {
+					float node[3];
+					RgbToLab(r * 255.0f / (n - 1), g * 255.0f / (n - 1), b * 255.0f / (n - 1), node);
+					node[0] *= lightnessWeight;
+					int best = 0;
+					float bestD = 1e30f;
+					for (int i = 0; i < count; i++) {
+						const float* p = &lab[(size_t)i * 3];
+						const float d = (node[0] - p[0]) * (node[0] - p[0]) + (node[1] - p[1]) * (node[1] - p[1]) +
+							(node[2] - p[2]) * (node[2] - p[2]);
+						if (d < bestD) { bestD = d; best = i; }
+					}
+					const size_t k = ((size_t)b * n + g) * n + r;
+					const unsigned char* c = palette + best * 4;
+					s->index[k] = (unsigned char)best;
+					s->color[k] = (unsigned int)c[0] | ((unsigned int)c[1] << 8) | ((unsigned int)c[2] << 16) | 0xFF000000u;
+				}
+			}
+		});
+		return s;
+	}
+
+	EXPORT_API void DestroyPaletteSnapper(void* snapper) {
+		delete (PaletteSnapper*)snapper;
+	}
+
+	// Snaps RGBA8 pixels in place (alpha kept). mode: 0 = nearest crayon, 1 = tetrahedral blend
+	// of the surrounding lattice crayons. indices (optional, width * height): crayon index of
+	// the nearest node. Region colours from ExtractRegionColors snap as a count x 1 image.
+	EXPORT_API bool SnapToPalette(void* snapper, unsigned char* rgba, int width, int height, int stride,
+		int mode, unsigned char* indices) {
+		const PaletteSnapper* s = (const PaletteSnapper*)snapper;
+		if (!s || !rgba || width < 1 || height < 1) return false;
+		if (stride <= 0) stride = width * 4;
+
+		const int bands = (height + PALETTE_BAND_ROWS - 1) / PALETTE_BAND_ROWS;
+		ParallelFor(bands, [s, rgba, width, height, stride, mode, indices](int band) {
+			const int n = s->size;
+			const int y0 = band * PALETTE_BAND_ROWS;
+			const int y1 = y0 + PALETTE_BAND_ROWS < height ? y0 + PALETTE_BAND_ROWS : height;
+			for (int y = y0; y < y1; y++) {
+				unsigned char* p = rgba + (size_t)y * stride;
+				unsigned char* idx = indices ? indices + (size_t)y * width : nullptr;
+				for (int x = 0; x < width; x++, p += 4) {
+					const size_t node = ((size_t)s->nearest[p[2]] * n + s->nearest[p[1]]) * n + s->nearest[p[0]];
+					if (idx) idx[x] = s->index[node];
+					const unsigned int c = mode == PALETTE_SNAP_TETRAHEDRAL ? SnapTetrahedral(*s, p) : s->color[node];
+					p[0] = (unsigned char)c;
+					p[1] = (unsigned char)(c >> 8);
+					p[2] = (unsigned char)(c >> 16);
+				}
+			}
+		});
+		return true;
+	}
+}
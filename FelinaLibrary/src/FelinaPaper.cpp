@@ -0,0 +1,292 @@
+// Felina paper illumination
+// Removes phone shadows and lamp gradients from an unwarped capture before the composite.
+// The paper white is estimated per tile on a 4x4-downsampled image: cells that are too
+// saturated (crayon) are skipped and a high percentile of the remaining luma is taken, so
+// line art and colouring inside a tile do not pull the estimate down. Tiles without enough
+// paper are filled from their neighbours, the grid is smoothed and its per-tile gains are
+// interpolated bilinearly and applied to RGB as 8.8 fixed point (alpha is kept).
+
+#include <algorithm> // std::nth_element
+#include <vector>
+
+#include "FelinaCommon.h"
+
+// --- INTERNAL HELPERS ---
+
+static const int PAPER_CELL = 4;                // Downsample factor of the statistics image
+static const int PAPER_BAND_ROWS = 16;          // Rows per worker task when applying
+static const int PAPER_DEFAULT_TILE = 32;       // Tile edge in pixels
+static const float PAPER_DEFAULT_PERCENTILE = 0.9f;
+static const float PAPER_DEFAULT_MAX_GAIN = 3.0f;
+static const float PAPER_MAX_GAIN = 8.0f;       // Keeps 255 * gain (8.8) inside 16 bits after the shift
+static const float PAPER_MAX_SATURATION = 0.2f; // (max - min) / max of a cell's mean RGB
+static const float PAPER_MIN_COVERAGE = 0.125f; // Paper cells a tile needs for its own estimate
+static const float PAPER_MIN_RELATIVE = 0.25f;  // Tile white below this x the median is not paper
+
+struct PaperGrid {
+	int tile;                       // Tile edge (pixels, multiple of PAPER_CELL)
+	int cols, rows;
+	std::vector<float> white;       // Per-tile paper luma (0..255, < 0 = no estimate)
+};
+
+// Per-channel sums of PAPER_CELL image rows (each <= 4 * 255, so 16 bits hold them)
+static void AccumulateRows(const unsigned char* row, int bytes, int rowStride, unsigned short* sum) {
+	memset(sum, 0, (size_t)bytes * sizeof(unsigned short));
+	for (int r = 0; r < PAPER_CELL; r++, row += rowStride) {
+		int i = 0;
+#if defined(FELINA_SSE)
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 16 <= bytes; i += 16) {
+			const __m128i v = _mm_loadu_si128((const __m128i*)(row + i));
+			__m128i* s = (__m128i*)(sum + i);
+			_mm_storeu_si128(s, _mm_add_epi16(_mm_loadu_si128(s), _mm_unpacklo_epi8(v, zero)));
+			_mm_storeu_si128(s + 1, _mm_add_epi16(_mm_loadu_si128(s + 1), _mm_unpackhi_epi8(v, zero)));
+		}
+#elif defined(FELINA_NEON)
+		for (; i + 16 <= bytes; i += 16) {
+			const uint8x16_t v = vld1q_u8(row + i);
+			vst1q_u16(sum + i, vaddw_u8(vld1q_u16(sum + i), vget_low_u8(v)));
+			vst1q_u16(sum + i + 8, vaddw_u8(vld1q_u16(sum + i + 8), vget_high_u8(v)));
+		}
+#endif
+		for (; i < bytes; i++) sum[i] += row[i];
+	}
+}
+
+// Paper white of one row of tiles: histogram the luma of unsaturated cells per tile and
+// take the percentile. Tiles with too few paper cells get -1.
+static void EstimateTileRow(const unsigned char* rgba, int width, int height, int stride,
+	float percentile, int tileRow, PaperGrid& grid) {
+	const int cellsPerTile = grid.tile / PAPER_CELL;
+	const int cellW = width / PAPER_CELL, cellH = height / PAPER_CELL;
+	const int cy0 = tileRow * cellsPerTile;
+	const int cy1 = cy0 + cellsPerTile < cellH ? cy0 + cellsPerTile : cellH;
+
+	std::vector<unsigned short> sum((size_t)cellW * PAPER_CELL * 4);
+	std::vector<int> hist((size_t)grid.cols * 256, 0);
+	std::vector<int> paper(grid.cols, 0), total(grid.cols, 0);
+
+	// 1. Cell means of the tile row, binned per tile
+	for (int cy = cy0; cy < cy1; cy++) {
+		AccumulateRows(rgba + (size_t)cy * PAPER_CELL * stride, cellW * PAPER_CELL * 4, stride, sum.data());
+		for (int cx = 0; cx < cellW; cx++) {
+			const unsigned short* s = &sum[(size_t)cx * PAPER_CELL * 4];
+			const int r = s[0] + s[4] + s[8] + s[12];
+			const int g = s[1] + s[5] + s[9] + s[13];
+			const int b = s[2] + s[6] + s[10] + s[14];
+			const int hi = r > g ? (r > b ? r : b) : (g > b ? g : b);
+			const int lo = r < g ? (r < b ? r : b) : (g < b ? g : b);
+			const int t = cx / cellsPerTile;
+			total[t]++;
+			if ((float)(hi - lo) > PAPER_MAX_SATURATION * (float)hi) continue;
+			const int luma = (77 * r + 150 * g + 29 * b) >> 12; // Weights / 256, sum / 16
+			hist[(size_t)t * 256 + luma]++;
+			paper[t]++;
+		}
+	}
+
+	// 2. Percentile per tile
+	for (int t = 0; t < grid.cols; t++) {
+		float& white = grid.white[(size_t)tileRow * grid.cols + t];
+		white = -1.0f;
+		if (paper[t] == 0 || (float)paper[t] < PAPER_MIN_COVERAGE * (float)total[t]) continue;
+		const int* h = &hist[(size_t)t * 256];
+		const int rank = (int)(percentile * (float)(paper[t] - 1));
+		int v = 0;
+		for (int seen = h[0]; seen <= rank; seen += h[++v]) {}
+		white = (float)v;
+	}
+}
+
+// Replaces tiles that are not paper (no estimate, or far darker than the typical tile) with
+// the mean of their estimated neighbours, growing inwards until the grid is full.
+// Returns false when no tile saw paper.
+static bool FillMissingTiles(PaperGrid& grid) {
+	std::vector<float>& w = grid.white;
+	std::vector<float> valid;
+	for (size_t i = 0; i < w.size(); i++) if (w[i] >= 0.0f) valid.push_back(w[i]);
+	if (valid.empty()) return false;
+	std::nth_element(valid.begin(), valid.begin() + valid.size() / 2, valid.end());
+	const float minWhite = PAPER_MIN_RELATIVE * valid[valid.size() / 2];
+	for (size_t i = 0; i < w.size(); i++) if (w[i] < minWhite) w[i] = -1.0f;
+
+	std::vector<float> next(w);
+	for (bool missing = true; missing;) {
+		missing = false;
+		for (int y = 0; y < grid.rows; y++) {
+			for (int x = 0; x < grid.cols; x++) {
+				const size_t i = (size_t)y * grid.cols + x;
+				if (w[i] >= 0.0f) continue;
+				float acc = 0.0f;
+				int n = 0;
+				if (x > 0 && w[i - 1] >= 0.0f) { acc += w[i - 1]; n++; }
+				if (x + 1 < grid.cols && w[i + 1] >= 0.0f) { acc += w[i + 1]; n++; }
+				if (y > 0 && w[i - grid.cols] >= 0.0f) { acc += w[i - grid.cols]; n++; }
+				if (y + 1 < grid.rows && w[i + grid.cols] >= 0.0f) { acc += w[i + grid.cols]; n++; }
+				if (n) next[i] = acc / n;
+				else missing = true;
+			}
+		}
+		w = next;
+	}
+	return true;
+}
+
+// [1 2 1] / 4 in both directions, edges clamped
+static void SmoothGrid(PaperGrid& grid) {
+	std::vector<float>& w = grid.white;
+	std::vector<float> tmp(w.size());
+	for (int y = 0; y < grid.rows; y++) {
+		const float* r = &w[(size_t)y * grid.cols];
+		for (int x = 0; x < grid.cols; x++) {
+			const float l = r[x > 0 ? x - 1 : x], c = r[x], rr = r[x + 1 < grid.cols ? x + 1 : x];
+			tmp[(size_t)y * grid.cols + x] = 0.25f * (l + 2.0f * c + rr);
+		}
+	}
+	for (int y = 0; y < grid.rows; y++) {
+		const float* u = &tmp[(size_t)(y > 0 ? y - 1 : y) * grid.cols];
+		const float* c = &tmp[(size_t)y * grid.cols];
+		const float* d = &tmp[(size_t)(y + 1 < grid.rows ? y + 1 : y) * grid.cols];
+		for (int x = 0; x < grid.cols; x++) w[(size_t)y * grid.cols + x] = 0.25f * (u[x] + 2.0f * c[x] + d[x]);
+	}
+}
+
+// Per-pixel 8.8 gains of image row y: bilinear between tile centres, constant past the outer ones
+static void BuildGainRow(const std::vector<float>& gain, int cols, int rows, int tile,
+	int width, int y, float* colGain, unsigned short* out) {
+	// 1. Vertical blend of the two tile rows around y
+	const float invTile = 1.0f / (float)tile;
+	float ty = ((float)y + 0.5f) * invTile - 0.5f;
+	ty = ty < 0.0f ? 0.0f : (ty > (float)(rows - 1) ? (float)(rows - 1) : ty);
+	const int r0 = (int)ty, r1 = r0 + 1 < rows ? r0 + 1 : r0;
+	const float fy = ty - (float)r0;
+	const float* g0 = &gain[(size_t)r0 * cols];
+	const float* g1 = &gain[(size_t)r1 * cols];
+	for (int c = 0; c < cols; c++) colGain[c] = (g0[c] + (g1[c] - g0[c]) * fy) * 256.0f;
+
+	// 2. Horizontal spans between tile centres
+	const int half = tile / 2;
+	int x = 0;
+	for (; x < half && x < width; x++) out[x] = (unsigned short)(colGain[0] + 0.5f);
+	for (int c = 0; c + 1 < cols; c++) {
+		const int xs = c * tile + half;
+		const int xe = xs + tile < width ? xs + tile : width;
+		const float a = colGain[c], slope = (colGain[c + 1] - colGain[c]) * invTile;
+		for (; x < xe; x++) out[x] = (unsigned short)(a + slope * ((float)(x - xs) + 0.5f) + 0.5f);
+	}
+	for (; x < width; x++) out[x] = (unsigned short)(colGain[cols - 1] + 0.5f);
+}
+
+// rgb = min(255, (rgb * gain + 128) >> 8) in place, alpha untouched
+static void ApplyGainRow(unsigned char* row, const unsigned short* gain, int width) {
+	int x = 0;
+#if defined(FELINA_SSE)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rgbMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+	const __m128i alphaOne = _mm_set_epi16(256, 0, 0, 0, 256, 0, 0, 0);
+	const __m128i round = _mm_set1_epi32(128);
+	for (; x + 4 <= width; x += 4) {
+		const __m128i px = _mm_loadu_si128((const __m128i*)(row + x * 4));
+		const __m128i g4 = _mm_loadl_epi64((const __m128i*)(gain + x));
+		const __m128i g2 = _mm_unpacklo_epi16(g4, g4);
+		const __m128i gain01 = _mm_or_si128(_mm_and_si128(_mm_unpacklo_epi32(g2, g2), rgbMask), alphaOne);
+		const __m128i gain23 = _mm_or_si128(_mm_and_si128(_mm_unpackhi_epi32(g2, g2), rgbMask), alphaOne);
+		__m128i half[2] = { _mm_unpacklo_epi8(px, zero), _mm_unpackhi_epi8(px, zero) };
+		const __m128i gains[2] = { gain01, gain23 };
+		for (int k = 0; k < 2; k++) {
+			const __m128i lo = _mm_mullo_epi16(half[k], gains[k]);
+			const __m128i hi = _mm_mulhi_epu16(half[k], gains[k]);
+			const __m128i a = _mm_srli_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 8);
+			const __m128i b = _mm_srli_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 8);
+			half[k] = _mm_packs_epi32(a, b);
+		}
+		_mm_storeu_si128((__m128i*)(row + x * 4), _mm_packus_epi16(half[0], half[1]));
+	}
+#elif defined(FELINA_NEON)
+	const uint16x4_t rgbMask = { 0xFFFF, 0xFFFF, 0xFFFF, 0 };
+	const uint16x4_t alphaOne = vdup_n_u16(256);
+	for (; x + 4 <= width; x += 4) {
+		const uint8x16_t px = vld1q_u8(row + x * 4);
+		const uint16x4x2_t g2 = vzip_u16(vld1_u16(gain + x), vld1_u16(gain + x));
+		const uint16x4x2_t g01 = vzip_u16(g2.val[0], g2.val[0]);
+		const uint16x4x2_t g23 = vzip_u16(g2.val[1], g2.val[1]);
+		const uint16x8_t lo = vmovl_u8(vget_low_u8(px)), hi = vmovl_u8(vget_high_u8(px));
+		const uint16x4_t r0 = vrshrn_n_u32(vmull_u16(vget_low_u16(lo), vbsl_u16(rgbMask, g01.val[0], alphaOne)), 8);
+		const uint16x4_t r1 = vrshrn_n_u32(vmull_u16(vget_high_u16(lo), vbsl_u16(rgbMask, g01.val[1], alphaOne)), 8);
+		const uint16x4_t r2 = vrshrn_n_u32(vmull_u16(vget_low_u16(hi), vbsl_u16(rgbMask, g23.val[0], alphaOne)), 8);
+		const uint16x4_t r3 = vrshrn_n_u32(vmull_u16(vget_high_u16(hi), vbsl_u16(rgbMask, g23.val[1], alphaOne)), 8);
+		vst1q_u8(row + x * 4, vcombine_u8(vqmovn_u16(vcombine_u16(r0, r1)), vqmovn_u16(vcombine_u16(r2, r3))));
+	}
+#endif
+	for (; x < width; x++) {
+		unsigned char* p = row + x * 4;
+		for (int c = 0; c < 3; c++) {
+			const unsigned int v = (p[c] * (unsigned int)gain[x] + 128) >> 8;
+			p[c] = (unsigned char)(v > 255 ? 255 : v);
+		}
+	}
+}
+
+extern "C" {
+
+	// --- STEP 18: PAPER ILLUMINATION NORMALISATION ---
+	// Flattens shading on an unwarped RGBA8 capture in place (run it between WarpImage and the
+	// composite). The paper white is estimated per tileSize x tileSize tile as the percentile
+	// of unsaturated 4x4-cell luma, smoothed, and each pixel's RGB is scaled by 255 / white,
+	// limited to [1, maxGain]. Values <= 0 select the defaults (32 px, 0.9, 3).
+	// paperWhite (optional): median tile white before the gain, 0..1.
+	// Returns false (image untouched) when no tile contains enough paper.
+	EXPORT_API bool NormalizePaperIllumination(
+		unsigned char* rgba, int width, int height, int stride,
+		int tileSize,
+		float percentile,
+		float maxGain,
+		float* paperWhite
+	) {
+		if (!rgba || width < PAPER_CELL || height < PAPER_CELL) return false;
+		if (stride <= 0) stride = width * 4;
+		if (tileSize <= 0) tileSize = PAPER_DEFAULT_TILE;
+		tileSize = tileSize < 2 * PAPER_CELL ? 2 * PAPER_CELL : tileSize / PAPER_CELL * PAPER_CELL;
+		if (percentile <= 0.0f || percentile > 1.0f) percentile = PAPER_DEFAULT_PERCENTILE;
+		if (maxGain <= 0.0f) maxGain = PAPER_DEFAULT_MAX_GAIN;
+		maxGain = maxGain < 1.0f ? 1.0f : (maxGain > PAPER_MAX_GAIN ? PAPER_MAX_GAIN : maxGain);
+
+		// 1. Tile estimates, one tile row per task
+		PaperGrid grid;
+		grid.tile = tileSize;
+		grid.cols = (width + tileSize - 1) / tileSize;
+		grid.rows = (height + tileSize - 1) / tileSize;
+		grid.white.resize((size_t)grid.cols * grid.rows);
+		ParallelFor(grid.rows, [rgba, width, height, stride, percentile, &grid](int row) {
+			EstimateTileRow(rgba, width, height, stride, percentile, row, grid);
+		});
+
+		// 2. Fill and smooth the grid, then turn it into gains
+		if (!FillMissingTiles(grid)) return false;
+		if (paperWhite) {
+			std::vector<float> sorted(grid.white);
+			std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+			*paperWhite = sorted[sorted.size() / 2] * (1.0f / 255.0f);
+		}
+		SmoothGrid(grid);
+		std::vector<float> gain(grid.white.size());
+		for (size_t i = 0; i < gain.size(); i++) {
+			const float g = 255.0f / (grid.white[i] > 1.0f ? grid.white[i] : 1.0f);
+			gain[i] = g < 1.0f ? 1.0f : (g > maxGain ? maxGain : g);
+		}
+
+		// 3. Apply, bands of rows in parallel
+		const int bands = (height + PAPER_BAND_ROWS - 1) / PAPER_BAND_ROWS;
+		ParallelFor(bands, [rgba, width, height, stride, &gain, &grid](int band) {
+			std::vector<float> colGain(grid.cols);
+			std::vector<unsigned short> gainRow(width);
+			const int y0 = band * PAPER_BAND_ROWS;
+			const int y1 = y0 + PAPER_BAND_ROWS < height ? y0 + PAPER_BAND_ROWS : height;
+			for (int y = y0; y < y1; y++) {
+				BuildGainRow(gain, grid.cols, grid.rows, grid.tile, width, y, colGain.data(), gainRow.data());
+				ApplyGainRow(rgba + (size_t)y * stride, gainRow.data(), width);
+			}
+		});
+		return true;
+	}
+}
@@ -0,0 +1,114 @@
+// Felina worker pool
+// A small persistent pool so image kernels can split work into tiles without paying
+// thread start-up per call. The pool is created on first use and intentionally never
+// destroyed: joining threads during DLL unload deadlocks on Windows.
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+
+#include "FelinaCommon.h"
+
+// --- INTERNAL HELPERS ---
+
+static const int POOL_MAX_WORKERS = 7;
+
+static thread_local bool t_insideParallel = false;
+
+class WorkerPool {
+public:
+	WorkerPool() : _job(nullptr), _count(0), _next(0), _active(0), _generation(0) {
+		int n = (int)std::thread::hardware_concurrency() - 1;
+		if (n < 0) n = 0;
+		if (n > POOL_MAX_WORKERS) n = POOL_MAX_WORKERS;
+		for (int i = 0; i < n; i++) {
+			std::thread t(&WorkerPool::WorkerLoop, this);
+			t.detach();
+		}
+		_workers = n;
+	}
+
+	int Workers() const { return _workers; }
+
+	// Returns false if the pool is already busy (caller runs serially)
+	bool Run(int count, const std::function<void(int)>& body) {
+		std::unique_lock<std::mutex> busy(_runMutex, std::try_to_lock);
+		if (!busy.owns_lock()) return false;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_job = &body;
+			_count = count;
+			_next.store(0);
+			_active = _workers;
+			_generation++;
+		}
+		_wake.notify_all();
+
+		// Caller participates
+		t_insideParallel = true;
+		Drain(body);
+		t_insideParallel = false;
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_done.wait(lock, [this] { return _active == 0; });
+		_job = nullptr;
+		return true;
+	}
+
+private:
+	void Drain(const std::function<void(int)>& body) {
+		for (;;) {
+			const int i = _next.fetch_add(1);
+			if (i >= _count) break;
+			body(i);
+		}
+	}
+
+	void WorkerLoop() {
+		t_insideParallel = true;
+		unsigned int seen = 0;
+		for (;;) {
+			const std::function<void(int)>* job;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_wake.wait(lock, [&] { return _generation != seen; });
+				seen = _generation;
+				job = _job;
+			}
+			Drain(*job);
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (--_active == 0) _done.notify_one();
+			}
+		}
+	}
+
+	int _workers;
+	std::mutex _runMutex;
+	std::mutex _mutex;
+	std::condition_variable _wake, _done;
+	const std::function<void(int)>* _job;
+	int _count;
+	std::atomic<int> _next;
+	int _active;
+	unsigned int _generation;
+};
+
+static WorkerPool* GetPool() {
+	static WorkerPool* pool = new WorkerPool();
+	return pool;
+}
+
+void ParallelFor(int count, const std::function<void(int)>& body) {
+	if (count <= 0) return;
+	if (count == 1 || t_insideParallel || GetPool()->Workers() == 0 || !GetPool()->Run(count, body)) {
+		for (int i = 0; i < count; i++) body(i);
+	}
+}
+
+int GetParallelism() {
+	return GetPool()->Workers() + 1;
+}
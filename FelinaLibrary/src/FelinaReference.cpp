@@ -0,0 +1,343 @@
+// Felina reference cache
+// Per-page data that depends only on the reference texture: the binary outline mask, its
+// Euclidean distance field and the index of enclosed regions. Built once per reference
+// name, off the capture path, and handed to captures as shared read-only pages.
+// Distance transform: exact squared-Euclidean in two separable passes (Meijster /
+// Felzenszwalb & Huttenlocher). Vertical distances come from a down and an up sweep over
+// whole rows (column strips in parallel), then each row takes the lower envelope of
+// parabolas (rows in parallel). Linear in the pixel count.
+// Regions: block-based union-find. Bands of rows are labelled in parallel with pixel
+// indices as provisional labels (no shared counter), the band seams are merged serially,
+// and the roots are numbered with a per-band prefix sum.
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "FelinaCommon.h"
+
+// --- INTERNAL HELPERS ---
+
+static const float REFERENCE_DEFAULT_THRESHOLD = 0.5f; // Luma below this is outline
+static const int REFERENCE_BAND_ROWS = 16;
+static const int REFERENCE_COLUMN_STRIP = 256;         // Columns per task in the vertical pass
+static const int REFERENCE_LABEL_ROWS = 64;            // Rows per union-find block
+
+static std::mutex s_referenceMutex;
+static std::map<std::string, std::shared_ptr<const ReferencePage> > s_references;
+
+// Vertical distance (in rows) to the nearest outline pixel of the same column, capped at 'far'
+static void ColumnDistances(const unsigned char* mask, int width, int height, int far, int* g) {
+	const int strips = (width + REFERENCE_COLUMN_STRIP - 1) / REFERENCE_COLUMN_STRIP;
+	ParallelFor(strips, [mask, width, height, far, g](int s) {
+		const int x0 = s * REFERENCE_COLUMN_STRIP;
+		const int x1 = x0 + REFERENCE_COLUMN_STRIP < width ? x0 + REFERENCE_COLUMN_STRIP : width;
+
+		// 1. Down sweep
+		for (int x = x0; x < x1; x++) g[x] = mask[x] ? 0 : far;
+		for (int y = 1; y < height; y++) {
+			const unsigned char* m = mask + (size_t)y * width;
+			const int* up = g + (size_t)(y - 1) * width;
+			int* cur = g + (size_t)y * width;
+			for (int x = x0; x < x1; x++) {
+				const int d = up[x] + 1 < far ? up[x] + 1 : far;
+				cur[x] = m[x] ? 0 : d;
+			}
+		}
+
+		// 2. Up sweep
+		for (int y = height - 2; y >= 0; y--) {
+			const int* down = g + (size_t)(y + 1) * width;
+			int* cur = g + (size_t)y * width;
+			for (int x = x0; x < x1; x++) {
+				const int d = down[x] + 1;
+				cur[x] = d < cur[x] ? d : cur[x];
+			}
+		}
+	});
+}
+
+// Row pass: d(x) = min over q of (x - q)^2 + g(q)^2, via the lower envelope of parabolas.
+// v / z are scratch of width and width + 1 entries.
+static void RowDistances(const int* g, int width, float* out, int* v, double* z) {
+	int k = 0;
+	v[0] = 0;
+	z[0] = -1e30;
+	z[1] = 1e30;
+	for (int q = 1; q < width; q++) {
+		// Pop parabolas the new one hides (z[0] = -inf stops the loop at the first)
+		const double fq = (double)g[q] * g[q] + (double)q * q;
+		double s;
+		for (;; k--) {
+			const int p = v[k];
+			s = (fq - ((double)g[p] * g[p] + (double)p * p)) / (2.0 * (q - p));
+			if (s > z[k]) break;
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = 1e30;
+	}
+	k = 0;
+	for (int q = 0; q < width; q++) {
+		while (z[k + 1] < q) k++;
+		const int p = v[k];
+		out[q] = sqrtf((float)((double)(q - p) * (q - p) + (double)g[p] * g[p]));
+	}
+}
+
+// Root of p with path halving. Unions always hang the larger root under the smaller, so a
+// root is the first pixel of its component in raster order.
+static inline int FindRoot(int* parent, int p) {
+	while (parent[p] != p) {
+		parent[p] = parent[parent[p]];
+		p = parent[p];
+	}
+	return p;
+}
+
+static inline void Union(int* parent, int a, int b) {
+	a = FindRoot(parent, a);
+	b = FindRoot(parent, b);
+	if (a < b) parent[b] = a;
+	else if (b < a) parent[a] = b;
+}
+
+// Labels the 4-connected non-outline areas of page->lineMask into regionMap / regions
+static void LabelRegions(ReferencePage& page) {
+	const int width = page.width, height = page.height;
+	const unsigned char* mask = page.lineMask.data();
+	page.regionMap.assign((size_t)width * height, 0);
+	int* label = page.regionMap.data();
+	std::vector<int> parentStorage((size_t)width * height);
+	int* parent = parentStorage.data();
+	const int bands = (height + REFERENCE_LABEL_ROWS - 1) / REFERENCE_LABEL_ROWS;
+
+	// 1. Union-find inside each band (a band only touches its own parent entries)
+	ParallelFor(bands, [mask, parent, width, height](int band) {
+		const int y0 = band * REFERENCE_LABEL_ROWS;
+		const int y1 = y0 + REFERENCE_LABEL_ROWS < height ? y0 + REFERENCE_LABEL_ROWS : height;
+		for (int y = y0; y < y1; y++) {
+			const int row = y * width;
+			for (int x = 0; x < width; x++) {
+				const int p = row + x;
+				if (mask[p]) { parent[p] = -1; continue; }
+				const bool left = x > 0 && !mask[p - 1], up = y > y0 && !mask[p - width];
+				if (left) {
+					// Join the left run; up only needs a union if the up-left pixel does not already link them
+					parent[p] = parent[p - 1];
+					if (up && mask[p - width - 1]) Union(parent, p, p - width);
+				}
+				else parent[p] = up ? parent[p - width] : p;
+			}
+		}
+	});
+
+	// 2. Seams between bands
+	for (int band = 1; band < bands; band++) {
+		const int row = band * REFERENCE_LABEL_ROWS * width;
+		for (int x = 0; x < width; x++) {
+			const int p = row + x;
+			if (!mask[p] && !mask[p - width]) Union(parent, p, p - width);
+		}
+	}
+
+	// 3. Resolve roots without writing to parent (other bands read it), count roots per band
+	std::vector<int> roots(bands + 1, 0);
+	ParallelFor(bands, [mask, parent, label, width, height, &roots](int band) {
+		const int p0 = band * REFERENCE_LABEL_ROWS * width;
+		const int p1 = (band + 1) * REFERENCE_LABEL_ROWS < height ? (band + 1) * REFERENCE_LABEL_ROWS * width : height * width;
+		int count = 0;
+		for (int p = p0; p < p1; p++) {
+			if (mask[p]) continue;
+			int r = p;
+			while (parent[r] != r) r = parent[r];
+			label[p] = r;
+			if (r == p) count++;
+		}
+		roots[band + 1] = count;
+	});
+	for (int band = 0; band < bands; band++) roots[band + 1] += roots[band];
+
+	// 4. Number the roots in raster order, then point every pixel at its root's number.
+	// Pixels keep the root's pixel index until then, so roots are read through parent.
+	ParallelFor(bands, [mask, parent, width, height, &roots](int band) {
+		const int p0 = band * REFERENCE_LABEL_ROWS * width;
+		const int p1 = (band + 1) * REFERENCE_LABEL_ROWS < height ? (band + 1) * REFERENCE_LABEL_ROWS * width : height * width;
+		int id = roots[band];
+		for (int p = p0; p < p1; p++)
+			if (!mask[p] && parent[p] == p) parent[p] = -2 - ++id; // Roots now hold -2 - id
+	});
+	ParallelFor(bands, [mask, parent, label, width, height](int band) {
+		const int p0 = band * REFERENCE_LABEL_ROWS * width;
+		const int p1 = (band + 1) * REFERENCE_LABEL_ROWS < height ? (band + 1) * REFERENCE_LABEL_ROWS * width : height * width;
+		for (int p = p0; p < p1; p++)
+			if (!mask[p]) label[p] = -2 - parent[label[p]];
+	});
+
+	// 5. Bounding boxes and areas: one partial table per worker, merged serially
+	const int count = roots[bands];
+	const int chunks = GetParallelism() < bands ? GetParallelism() : bands;
+	std::vector<std::vector<ReferenceRegion> > partial(chunks);
+	ParallelFor(chunks, [label, width, height, count, chunks, &partial](int c) {
+		std::vector<ReferenceRegion>& r = partial[c];
+		const ReferenceRegion empty = { width, height, 0, 0, 0 };
+		r.assign(count, empty);
+		const int y0 = (int)((long long)height * c / chunks), y1 = (int)((long long)height * (c + 1) / chunks);
+		for (int y = y0; y < y1; y++) {
+			const int* l = label + (size_t)y * width;
+			for (int x = 0; x < width; x++) {
+				if (!l[x]) continue;
+				ReferenceRegion& g = r[l[x] - 1];
+				if (x < g.x0) g.x0 = x;
+				if (x >= g.x1) g.x1 = x + 1;
+				if (y < g.y0) g.y0 = y;
+				g.y1 = y + 1;
+				g.area++;
+			}
+		}
+	});
+	page.regions.swap(partial[0]);
+	for (int c = 1; c < chunks; c++) {
+		for (int i = 0; i < count; i++) {
+			const ReferenceRegion& s = partial[c][i];
+			if (!s.area) continue;
+			ReferenceRegion& d = page.regions[i];
+			if (s.x0 < d.x0) d.x0 = s.x0;
+			if (s.y0 < d.y0) d.y0 = s.y0;
+			if (s.x1 > d.x1) d.x1 = s.x1;
+			if (s.y1 > d.y1) d.y1 = s.y1;
+			d.area += s.area;
+		}
+	}
+}
+
+static std::shared_ptr<ReferencePage> BuildReferencePage(const unsigned char* rgba, int width, int height,
+	int stride, float threshold) {
+	std::shared_ptr<ReferencePage> page = std::make_shared<ReferencePage>();
+	page->width = width;
+	page->height = height;
+	page->lineThreshold = threshold;
+	page->lineMask.resize((size_t)width * height);
+	page->distance.resize((size_t)width * height);
+
+	// 1. Outline mask: dark and opaque (luma weights / 256)
+	const int limit = (int)(threshold * 255.0f * 256.0f);
+	const int bands = (height + REFERENCE_BAND_ROWS - 1) / REFERENCE_BAND_ROWS;
+	unsigned char* mask = page->lineMask.data();
+	ParallelFor(bands, [rgba, width, height, stride, limit, mask](int band) {
+		const int y0 = band * REFERENCE_BAND_ROWS;
+		const int y1 = y0 + REFERENCE_BAND_ROWS < height ? y0 + REFERENCE_BAND_ROWS : height;
+		for (int y = y0; y < y1; y++) {
+			const unsigned char* p = rgba + (size_t)y * stride;
+			unsigned char* m = mask + (size_t)y * width;
+			for (int x = 0; x < width; x++, p += 4) {
+				const int luma = 77 * p[0] + 150 * p[1] + 29 * p[2];
+				m[x] = (luma < limit && p[3] >= 128) ? 255 : 0;
+			}
+		}
+	});
+
+	// 2. Vertical distances; 'far' exceeds any in-image distance so empty columns lose every envelope
+	std::vector<int> g((size_t)width * height);
+	ColumnDistances(mask, width, height, width + height, g.data());
+
+	// 3. Horizontal envelopes
+	float* dist = page->distance.data();
+	const int* gp = g.data();
+	ParallelFor(bands, [gp, width, height, dist](int band) {
+		std::vector<int> v(width);
+		std::vector<double> z(width + 1);
+		const int y0 = band * REFERENCE_BAND_ROWS;
+		const int y1 = y0 + REFERENCE_BAND_ROWS < height ? y0 + REFERENCE_BAND_ROWS : height;
+		for (int y = y0; y < y1; y++)
+			RowDistances(gp + (size_t)y * width, width, dist + (size_t)y * width, v.data(), z.data());
+	});
+
+	// 4. Region index
+	LabelRegions(*page);
+	return page;
+}
+
+// --- CACHE ACCESS (declared in FelinaCommon.h) ---
+
+std::shared_ptr<const ReferencePage> FindReference(const char* name) {
+	if (!name) return std::shared_ptr<const ReferencePage>();
+	std::lock_guard<std::mutex> lock(s_referenceMutex);
+	std::map<std::string, std::shared_ptr<const ReferencePage> >::const_iterator it = s_references.find(name);
+	return it != s_references.end() ? it->second : std::shared_ptr<const ReferencePage>();
+}
+
+extern "C" {
+
+	// --- STEP 20: REFERENCE LINE MASK + DISTANCE FIELD ---
+	// Builds the outline mask (luma < lineThreshold, alpha >= 0.5; <= 0 selects 0.5) and its
+	// distance field for a reference texture and caches them under name. Call it when the
+	// reference library loads: a name already prepared at the same size and threshold returns
+	// immediately, so captures never rebuild it. rgba: 8-bit RGBA, stride in bytes (0 = packed).
+	EXPORT_API bool PrepareReference(const char* name, unsigned char* rgba, int width, int height, int stride,
+		float lineThreshold) {
+		if (!name || !rgba || width < 1 || height < 1) return false;
+		if (stride <= 0) stride = width * 4;
+		if (lineThreshold <= 0.0f) lineThreshold = REFERENCE_DEFAULT_THRESHOLD;
+
+		{
+			std::lock_guard<std::mutex> lock(s_referenceMutex);
+			std::map<std::string, std::shared_ptr<const ReferencePage> >::const_iterator it = s_references.find(name);
+			if (it != s_references.end() && it->second->width == width && it->second->height == height &&
+				it->second->lineThreshold == lineThreshold) return true;
+		}
+
+		// Built outside the lock so captures of other pages are not held up
+		std::shared_ptr<const ReferencePage> page = BuildReferencePage(rgba, width, height, stride, lineThreshold);
+		std::lock_guard<std::mutex> lock(s_referenceMutex);
+		s_references[name] = page;
+		return true;
+	}
+
+	// Copies the cached data out (each pointer optional, width * height entries, row-major).
+	// Returns false if name was never prepared.
+	EXPORT_API bool GetReferenceDistanceField(const char* name, unsigned char* lineMask, float* distance,
+		int* width, int* height) {
+		std::shared_ptr<const ReferencePage> page = FindReference(name);
+		if (!page) return false;
+		if (width) *width = page->width;
+		if (height) *height = page->height;
+		if (lineMask) memcpy(lineMask, page->lineMask.data(), page->lineMask.size());
+		if (distance) memcpy(distance, page->distance.data(), page->distance.size() * sizeof(float));
+		return true;
+	}
+
+	// --- STEP 21: REFERENCE REGIONS ---
+	// The page's enclosed areas: 4-connected pixels between outlines, labelled once in
+	// PrepareReference. Returns the region count, or -1 if name was never prepared.
+	EXPORT_API int GetReferenceRegionCount(const char* name) {
+		std::shared_ptr<const ReferencePage> page = FindReference(name);
+		return page ? (int)page->regions.size() : -1;
+	}
+
+	// regionMap: width * height ids (0 on outlines, 1..count in raster order of first pixel).
+	// bounds: count x (x, y, width, height); areas: count pixel counts. Each pointer optional.
+	EXPORT_API bool GetReferenceRegions(const char* name, int* regionMap, int* bounds, int* areas) {
+		std::shared_ptr<const ReferencePage> page = FindReference(name);
+		if (!page) return false;
+		if (regionMap) memcpy(regionMap, page->regionMap.data(), page->regionMap.size() * sizeof(int));
+		for (size_t i = 0; i < page->regions.size(); i++) {
+			const ReferenceRegion& r = page->regions[i];
+			if (bounds) {
+				bounds[i * 4 + 0] = r.x0; bounds[i * 4 + 1] = r.y0;
+				bounds[i * 4 + 2] = r.x1 - r.x0; bounds[i * 4 + 3] = r.y1 - r.y0;
+			}
+			if (areas) areas[i] = r.area;
+		}
+		return true;
+	}
+
+	// Drops one page (name) or, with a null name, the whole cache. Captures still holding the
+	// page keep it until they finish.
+	EXPORT_API void ReleaseReference(const char* name) {
+		std::lock_guard<std::mutex> lock(s_referenceMutex);
+		if (name) s_references.erase(name);
+		else s_references.clear();
+	}
+}
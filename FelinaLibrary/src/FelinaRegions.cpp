@@ -0,0 +1,325 @@
+// Felina region colour
+// Turns a noisy crayon capture into flat fills using the region index of its reference
+// (FelinaReference.cpp). One scan of the unwarped capture bins every pixel into per-region
+// channel histograms (one set per worker, merged afterwards); a small per-region reduction
+// picks a robust colour (median or interquartile mean) and a second scan writes it out.
+// Pixels near outlines are left out of the statistics because misalignment mixes line ink
+// into them.
+// Outline bleed: outline pixels of the unwarped texture take the colour of the nearest
+// non-outline pixel, so the composite's multiply darkens region colour instead of stray ink.
+// Nearest pixels come from an exact feature transform in two separable passes (nearest seed
+// row per column, then the lower envelope of parabolas per row), linear in the pixel count.
+
+#include <vector>
+
+#include "FelinaCommon.h"
+
+// --- INTERNAL HELPERS ---
+
+static const float REGION_DEFAULT_EDGE_MARGIN = 2.0f; // Reference pixels kept clear of outlines
+static const int REGION_BAND_ROWS = 16;
+static const size_t REGION_MAX_HISTOGRAM_BYTES = 32u << 20; // Caps worker copies for pages with many regions
+static const float REGION_DEFAULT_BLEED_MARGIN = 1.0f; // Only outline pixels themselves are refilled
+static const int REGION_COLUMN_STRIP = 256;         // Columns per task in the vertical pass
+static const int REGION_NO_SEED = -(1 << 29);       // Column without any seed pixel
+
+enum {
+	REGION_COLOR_MEDIAN = 0,
+	REGION_COLOR_TRIMMED_MEAN = 1      // Mean of the middle half
+};
+
+// Capture pixel -> nearest reference pixel along one axis
+static void BuildAxisMap(int captureSize, int referenceSize, std::vector<int>& map) {
+	map.resize(captureSize);
+	for (int i = 0; i < captureSize; i++)
+		map[i] = (int)(((long long)(2 * i + 1) * referenceSize) / (2LL * captureSize));
+}
+
+// Per-worker statistics: 3 x 256 bins per region for interior pixels, plus plain RGB sums
+// of every pixel for regions too thin to have an interior
+struct RegionAccumulator {
+	std::vector<unsigned int> hist;
+	std::vector<unsigned long long> sum; // r, g, b, count per region
+};
+
+// Robust value of one channel histogram with n samples
+static float HistogramValue(const unsigned int* h, unsigned int n, int method) {
+	if (method == REGION_COLOR_TRIMMED_MEAN) {
+		// Ranks [n / 4, 3n / 4), partial bins at both ends
+		const double lo = n * 0.25, hi = n * 0.75;
+		double seen = 0.0, acc = 0.0;
+		for (int v = 0; v < 256 && seen < hi; v++) {
+			const double b0 = seen, b1 = seen + h[v];
+			seen = b1;
+			const double take = (b1 < hi ? b1 : hi) - (b0 > lo ? b0 : lo);
+			if (take > 0.0) acc += take * v;
+		}
+		return (float)(acc / (hi - lo));
+	}
+	const unsigned int half = n / 2;
+	unsigned int seen = 0;
+	for (int v = 0; v < 256; v++) {
+		seen += h[v];
+		if (seen > half) return (float)v;
+	}
+	return 255.0f;
+}
+
+// Row of the nearest seed pixel in the same column (REGION_NO_SEED if the column has none)
+static void NearestSeedRows(const unsigned char* seed, int width, int height, int* rows) {
+	const int strips = (width + REGION_COLUMN_STRIP - 1) / REGION_COLUMN_STRIP;
+	ParallelFor(strips, [seed, width, height, rows](int s) {
+		const int x0 = s * REGION_COLUMN_STRIP;
+		const int x1 = x0 + REGION_COLUMN_STRIP < width ? x0 + REGION_COLUMN_STRIP : width;
+
+		// 1. Down sweep: last seed at or above
+		for (int x = x0; x < x1; x++) rows[x] = seed[x] ? 0 : REGION_NO_SEED;
+		for (int y = 1; y < height; y++) {
+			const unsigned char* m = seed + (size_t)y * width;
+			const int* up = rows + (size_t)(y - 1) * width;
+			int* cur = rows + (size_t)y * width;
+			for (int x = x0; x < x1; x++) cur[x] = m[x] ? y : up[x];
+		}
+
+		// 2. Up sweep: take the row below's seed where it is closer. No sentinel test is needed:
+		// a missing seed above loses to any seed, and a missing one below is only passed up
+		// into rows that have none either.
+		for (int y = height - 2; y >= 0; y--) {
+			const int* down = rows + (size_t)(y + 1) * width;
+			int* cur = rows + (size_t)y * width;
+			for (int x = x0; x < x1; x++) cur[x] = down[x] - y < y - cur[x] ? down[x] : cur[x];
+		}
+	});
+}
+
+// Nearest seed of every pixel q in [a, b) of row y: the one minimising
+// (x - q)^2 + (y - rows[x])^2 over x in [lo, hi), found on the lower envelope of the
+// per-column parabolas (columns without a seed are left out). v / z are scratch of
+// hi - lo and hi - lo + 1 entries; some column in [lo, hi) must hold a seed.
+static void BleedSpan(unsigned char* rgba, int stride, int y, const int* rows, int lo, int hi, int a, int b,
+	int* v, double* z) {
+	int k = -1;
+	for (int q = lo; q < hi; q++) {
+		if (rows[q] == REGION_NO_SEED) continue;
+		const double dq = y - rows[q], fq = dq * dq + (double)q * q;
+		if (k < 0) {
+			k = 0;
+			v[0] = q;
+			z[0] = -1e30;
+			z[1] = 1e30;
+			continue;
+		}
+		// Pop parabolas the new one hides (z[0] = -inf stops the loop at the first)
+		double s;
+		for (;; k--) {
+			const int p = v[k];
+			const double dp = y - rows[p];
+			s = (fq - (dp * dp + (double)p * p)) / (2.0 * (q - p));
+			if (s > z[k]) break;
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = 1e30;
+	}
+
+	unsigned char* dst = rgba + (size_t)y * stride;
+	k = 0;
+	for (int q = a; q < b; q++) {
+		while (z[k + 1] < q) k++;
+		const int p = v[k];
+		memcpy(dst + q * 4, rgba + (size_t)rows[p] * stride + p * 4, 4);
+	}
+}
+
+// Refills the non-seed runs of row y. The nearest seed of q is no farther than the run's
+// seeds in its own row or the column's nearest seed row, so only columns within the largest
+// such bound over the run can hold it: the envelope covers little more than the run instead
+// of the whole row, which keeps the row pass proportional to the outline pixels.
+static void BleedRow(unsigned char* rgba, int stride, int width, int y, const int* rows,
+	const unsigned char* seed, int* v, double* z) {
+	for (int a = 0; a < width; a++) {
+		if (seed[a]) continue;
+		int b = a + 1;
+		while (b < width && !seed[b]) b++;
+		int reach = 0;
+		for (int q = a; q < b; q++) {
+			int r = y - rows[q] < rows[q] - y ? rows[q] - y : y - rows[q]; // Huge without a seed
+			if (a > 0 && q - a + 1 < r) r = q - a + 1;
+			if (b < width && b - q < r) r = b - q;
+			if (r > reach) reach = r;
+		}
+		const int lo = a - reach > 0 ? a - reach : 0;
+		const int hi = b + reach < width ? b + reach : width;
+		BleedSpan(rgba, stride, y, rows, lo, hi, a, b, v, z);
+		a = b;
+	}
+}
+
+extern "C" {
+
+	// --- STEP 22: REGION FLAT COLOURS ---
+	// Robust colour of every region of a prepared reference, measured on the unwarped capture
+	// (RGBA8, any size: it is mapped onto the reference by scaling). Pixels closer than
+	// edgeMargin reference pixels to an outline are ignored (< 0 selects 2); regions with no
+	// such interior fall back to the mean of all their pixels.
+	// method: 0 = per-channel median, 1 = mean of the middle half.
+	// flat (optional, same size and stride as capture, may be capture itself): every region
+	// filled with its colour, outline pixels copied from the capture.
+	// colors (optional): GetReferenceRegionCount x RGBA8, region id - 1 order.
+	EXPORT_API bool ExtractRegionColors(
+		const char* name,
+		unsigned char* capture, int width, int height, int stride,
+		float edgeMargin,
+		int method,
+		unsigned char* flat,
+		unsigned char* colors
+	) {
+		std::shared_ptr<const ReferencePage> page = FindReference(name);
+		if (!page || !capture || width < 1 || height < 1) return false;
+		if (stride <= 0) stride = width * 4;
+		if (edgeMargin < 0.0f) edgeMargin = REGION_DEFAULT_EDGE_MARGIN;
+		const int count = (int)page->regions.size();
+		if (count == 0) return false;
+
+		std::vector<int> mapX, mapY;
+		BuildAxisMap(width, page->width, mapX);
+		BuildAxisMap(height, page->height, mapY);
+		const int* regionMap = page->regionMap.data();
+		const float* distance = page->distance.data();
+		const int refW = page->width;
+
+		// 1. One scan: per-worker histograms (worker count limited by histogram memory)
+		const size_t histBytes = (size_t)count * 3 * 256 * sizeof(unsigned int);
+		int workers = GetParallelism();
+		if ((size_t)workers * histBytes > REGION_MAX_HISTOGRAM_BYTES) workers = (int)(REGION_MAX_HISTOGRAM_BYTES / histBytes);
+		if (workers < 1) workers = 1;
+		if (workers > height) workers = height;
+		std::vector<RegionAccumulator> acc(workers);
+		ParallelFor(workers, [&](int w) {
+			RegionAccumulator& a = acc[w];
+			a.hist.assign((size_t)count * 3 * 256, 0);
+			a.sum.assign((size_t)count * 4, 0);
+			const int y0 = (int)((long long)height * w / workers), y1 = (int)((long long)height * (w + 1) / workers);
+			for (int y = y0; y < y1; y++) {
+				const unsigned char* p = capture + (size_t)y * stride;
+				const size_t refRow = (size_t)mapY[y] * refW;
+				for (int x = 0; x < width; x++, p += 4) {
+					const size_t r = refRow + mapX[x];
+					const int id = regionMap[r];
+					if (!id) continue;
+					unsigned long long* s = &a.sum[(size_t)(id - 1) * 4];
+					s[0] += p[0]; s[1] += p[1]; s[2] += p[2]; s[3]++;
+					if (distance[r] < edgeMargin) continue;
+					unsigned int* h = &a.hist[(size_t)(id - 1) * 768];
+					h[p[0]]++; h[256 + p[1]]++; h[512 + p[2]]++;
+				}
+			}
+		});
+
+		// 2. Per-region reduction (regions split over the workers, histograms merged into worker 0)
+		std::vector<unsigned char> rgba((size_t)count * 4);
+		ParallelFor(count, [&](int i) {
+			unsigned int* h = &acc[0].hist[(size_t)i * 768];
+			unsigned long long* s = &acc[0].sum[(size_t)i * 4];
+			for (int w = 1; w < workers; w++) {
+				const unsigned int* hw = &acc[w].hist[(size_t)i * 768];
+				for (int k = 0; k < 768; k++) h[k] += hw[k];
+				for (int k = 0; k < 4; k++) s[k] += acc[w].sum[(size_t)i * 4 + k];
+			}
+			unsigned int n = 0;
+			for (int v = 0; v < 256; v++) n += h[v];
+			unsigned char* out = &rgba[(size_t)i * 4];
+			for (int c = 0; c < 3; c++) {
+				float v;
+				if (n) v = HistogramValue(h + c * 256, n, method);
+				else v = s[3] ? (float)s[c] / (float)s[3] : 0.0f;
+				out[c] = (unsigned char)(v + 0.5f);
+			}
+			out[3] = 255;
+		});
+		if (colors) memcpy(colors, rgba.data(), rgba.size());
+		if (!flat) return true;
+
+		// 3. Flat fill
+		const unsigned char* fill = rgba.data();
+		const int bands = (height + REGION_BAND_ROWS - 1) / REGION_BAND_ROWS;
+		ParallelFor(bands, [=, &mapX, &mapY](int band) {
+			const int y0 = band * REGION_BAND_ROWS;
+			const int y1 = y0 + REGION_BAND_ROWS < height ? y0 + REGION_BAND_ROWS : height;
+			for (int y = y0; y < y1; y++) {
+				const unsigned char* src = capture + (size_t)y * stride;
+				unsigned char* dst = flat + (size_t)y * stride;
+				const int* ids = regionMap + (size_t)mapY[y] * refW;
+				for (int x = 0; x < width; x++) {
+					const int id = ids[mapX[x]];
+					const unsigned char* c = id ? fill + (size_t)(id - 1) * 4 : src + x * 4;
+					memcpy(dst + x * 4, c, 4);
+				}
+			}
+		});
+		return true;
+	}
+
+	// --- STEP 24: OUTLINE BLEED ---
+	// Refills the outlines of an unwarped texture (RGBA8 in place, any size: the prepared
+	// reference is mapped onto it by scaling) with the colour of the nearest pixel that is at
+	// least edgeMargin reference pixels from an outline (< 0 selects 1: outline pixels only).
+	// Run on the flat output of ExtractRegionColors this gives every outline pixel its nearest
+	// region colour; alpha is carried along. Returns false if nothing lies beyond the margin.
+	EXPORT_API bool BleedUnderOutlines(
+		const char* name,
+		unsigned char* rgba, int width, int height, int stride,
+		float edgeMargin
+	) {
+		std::shared_ptr<const ReferencePage> page = FindReference(name);
+		if (!page || !rgba || width < 1 || height < 1) return false;
+		if (stride <= 0) stride = width * 4;
+		if (edgeMargin < 0.0f) edgeMargin = REGION_DEFAULT_BLEED_MARGIN;
+
+		std::vector<int> mapX, mapY;
+		BuildAxisMap(width, page->width, mapX);
+		BuildAxisMap(height, page->height, mapY);
+		const float* distance = page->distance.data();
+		const int refW = page->width;
+
+		// 1. Seed mask (1 = keeps its colour), seeds per row
+		std::vector<unsigned char> seed((size_t)width * height);
+		std::vector<int> rowSeeds(height);
+		const int bands = (height + REGION_BAND_ROWS - 1) / REGION_BAND_ROWS;
+		ParallelFor(bands, [&, width, height, edgeMargin, refW](int band) {
+			const int y0 = band * REGION_BAND_ROWS;
+			const int y1 = y0 + REGION_BAND_ROWS < height ? y0 + REGION_BAND_ROWS : height;
+			for (int y = y0; y < y1; y++) {
+				const float* d = distance + (size_t)mapY[y] * refW;
+				unsigned char* m = &seed[(size_t)y * width];
+				int seeds = 0;
+				for (int x = 0; x < width; x++) {
+					m[x] = d[mapX[x]] >= edgeMargin;
+					seeds += m[x];
+				}
+				rowSeeds[y] = seeds;
+			}
+		});
+		bool any = false;
+		for (int y = 0; y < height && !any; y++) any = rowSeeds[y] > 0;
+		if (!any) return false;
+
+		// 2. Nearest seed row per column
+		std::vector<int> rows((size_t)width * height);
+		NearestSeedRows(seed.data(), width, height, rows.data());
+
+		// 3. Refill, rows in parallel (only non-seed pixels are written, only seeds are read)
+		ParallelFor(bands, [&, rgba, width, height, stride](int band) {
+			std::vector<int> v(width);
+			std::vector<double> z(width + 1);
+			const int y0 = band * REGION_BAND_ROWS;
+			const int y1 = y0 + REGION_BAND_ROWS < height ? y0 + REGION_BAND_ROWS : height;
+			for (int y = y0; y < y1; y++) {
+				if (rowSeeds[y] == width) continue;
+				BleedRow(rgba, stride, width, y, &rows[(size_t)y * width], &seed[(size_t)y * width], v.data(), z.data());
+			}
+		});
+		return true;
+	}
+}
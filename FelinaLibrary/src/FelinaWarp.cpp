@@ -0,0 +1,1524 @@
+// Felina CPU warp engine
+// Native equivalent of the unwarp Blit: every output texel is mapped through the
+// _Unwarp homography and the _DisplayMatrix into the camera image and sampled there.
+// Works headless (no GPU), so captures can be regenerated server-side and tested
+// deterministically. Output tiles are spread over the worker pool in source-space order;
+// coordinates are computed 4 pixels at a time and the RGBA channels are blended as one SIMD vector.
+// Filters: bilinear (tex2D), Catmull-Rom bicubic (unwarp.shader's tex2D_bicubic), a fixed-point
+// bilinear for RGBA8 end to end and an anisotropic footprint filter for downsampling.
+// Bilinear and bicubic also read and write ARGBHalf buffers directly, and camera YUV 4:2:0
+// planes are converted inside the sampling loop.
+
+#include <algorithm> // std::sort
+#include <memory>    // std::unique_ptr
+#include <vector>
+
+#include "FelinaCommon.h"
+
+// --- INTERNAL HELPERS ---
+
+static const int WARP_BAND_ROWS = 16;
+static const int WARP_TILE = 32;               // Output tile edge (pixels)
+static const int WARP_TILE_RUN = 4;            // Consecutive tiles per worker task
+static const int BICUBIC_PHASES = 256;         // Sub-texel phases of the weight table
+static const int HALF_TEXEL_BYTES = 8;         // ARGBHalf: 4 x binary16
+
+struct WarpImageDesc {
+	unsigned char* pixels;
+	int width, height;
+	int stride;                     // Bytes per row
+};
+
+struct CompositeParams;
+struct YuvPlanes;
+
+struct WarpParams {
+	WarpImageDesc src, dst;
+	float g[9];                     // Output pixel (x, y, 1) -> source texel coordinates (row-major)
+	float maxError;                 // Scanline span tolerance in source texels (0 = exact divide per pixel)
+	const CompositeParams* composite; // Optional ARColoringComposite applied per tile row
+	bool half;                      // src and dst are ARGBHalf instead of RGBA8
+	const YuvPlanes* yuv;           // src is the luma plane of a YUV 4:2:0 frame
+};
+
+// Folds everything the shader does per pixel into one homography:
+// G = S_src * D * H * S_out, where S_out maps output pixel centres to UV, H is _Unwarp,
+// D the affine part of _DisplayMatrix and S_src maps texture UV to texel centres.
+static bool BuildWarpMatrix(const Float4x4* unwarp, const Float4x4* display,
+	int srcW, int srcH, int dstW, int dstH, float* g) {
+	float h[9];
+	UnpackMatrix(unwarp, h);
+
+	float d[9] = { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+	if (display) {
+		// mul(_DisplayMatrix, float4(s, 0, 1)).xy
+		d[0] = display->c0x; d[1] = display->c1x; d[2] = display->c3x;
+		d[3] = display->c0y; d[4] = display->c1y; d[5] = display->c3y;
+	}
+
+	const float sOut[9] = {
+		1.0f / dstW, 0.0f, 0.5f / dstW,
+		0.0f, 1.0f / dstH, 0.5f / dstH,
+		0.0f, 0.0f, 1.0f
+	};
+	const float sSrc[9] = {
+		(float)srcW, 0.0f, -0.5f,
+		0.0f, (float)srcH, -0.5f,
+		0.0f, 0.0f, 1.0f
+	};
+
+	float a[9], b[9];
+	Mat3Mul(h, sOut, a);
+	Mat3Mul(d, a, b);
+	Mat3Mul(sSrc, b, g);
+
+	float inv[9];
+	return Mat3Inverse(g, inv);
+}
+
+// Bilinear RGBA8 fetch at clamped texel coordinates (x in [0, w-1], y in [0, h-1])
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+static inline Vec4f BilinearTexel(const WarpImageDesc& src, float x, float y) {
+	int ix = (int)x, iy = (int)y;
+	if (ix > src.width - 2) ix = src.width - 2;
+	if (iy > src.height - 2) iy = src.height - 2;
+	const float fx = x - ix, fy = y - iy;
+	const unsigned char* r0 = src.pixels + (size_t)iy * src.stride + ix * 4;
+	const unsigned char* r1 = r0 + src.stride;
+
+#if defined(FELINA_SSE)
+	const __m128i z = _mm_setzero_si128();
+	const __m128i t = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)r0), z);
+	const __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)r1), z);
+	const __m128 p00 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(t, z));
+	const __m128 p01 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(t, z));
+	const __m128 p10 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(b, z));
+	const __m128 p11 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(b, z));
+	const __m128 vfx = _mm_set1_ps(fx), vfy = _mm_set1_ps(fy);
+	const __m128 top = _mm_add_ps(p00, _mm_mul_ps(_mm_sub_ps(p01, p00), vfx));
+	const __m128 bot = _mm_add_ps(p10, _mm_mul_ps(_mm_sub_ps(p11, p10), vfx));
+	return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bot, top), vfy));
+#else
+	const uint16x8_t t = vmovl_u8(vld1_u8(r0));
+	const uint16x8_t b = vmovl_u8(vld1_u8(r1));
+	const float32x4_t p00 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(t)));
+	const float32x4_t p01 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(t)));
+	const float32x4_t p10 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(b)));
+	const float32x4_t p11 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(b)));
+	const float32x4_t top = vmlaq_n_f32(p00, vsubq_f32(p01, p00), fx);
+	const float32x4_t bot = vmlaq_n_f32(p10, vsubq_f32(p11, p10), fx);
+	return vmlaq_n_f32(top, vsubq_f32(bot, top), fy);
+#endif
+}
+#endif
+
+static inline void BilinearRGBA8(const WarpImageDesc& src, float x, float y, unsigned char* out) {
+#if defined(FELINA_SSE)
+	__m128i i = _mm_cvtps_epi32(BilinearTexel(src, x, y));
+	i = _mm_packs_epi32(i, i);
+	i = _mm_packus_epi16(i, i);
+	const int packed = _mm_cvtsi128_si32(i);
+	memcpy(out, &packed, 4);
+#elif defined(FELINA_NEON)
+	const uint16x4_t n16 = vqmovn_u32(vcvtnq_u32_f32(BilinearTexel(src, x, y)));
+	const uint8x8_t n8 = vqmovn_u16(vcombine_u16(n16, n16));
+	vst1_lane_u32((uint32_t*)out, vreinterpret_u32_u8(n8), 0);
+#else
+	int ix = (int)x, iy = (int)y;
+	if (ix > src.width - 2) ix = src.width - 2;
+	if (iy > src.height - 2) iy = src.height - 2;
+	const float fx = x - ix, fy = y - iy;
+	const unsigned char* r0 = src.pixels + (size_t)iy * src.stride + ix * 4;
+	const unsigned char* r1 = r0 + src.stride;
+	for (int c = 0; c < 4; c++) {
+		const float top = r0[c] + (r0[c + 4] - r0[c]) * fx;
+		const float bot = r1[c] + (r1[c + 4] - r1[c]) * fx;
+		const float v = top + (bot - top) * fy;
+		out[c] = (unsigned char)(v + 0.5f);
+	}
+#endif
+}
+
+// --- BICUBIC (Catmull-Rom) ---
+// unwarp.shader's tex2D_bicubic samples the 4x4 texels around uv * size - 0.5 with the
+// Catmull-Rom cubic (a = -0.5; its 's' vector holds the cubic coefficients). Weights are
+// precomputed for BICUBIC_PHASES + 1 quantised phases, so a fetch is two table lookups,
+// 4 row loads of 16 bytes and 20 multiply-adds on 4-channel vectors.
+
+struct BicubicTable {
+	float w[BICUBIC_PHASES + 1][4];
+	BicubicTable() {
+		for (int p = 0; p <= BICUBIC_PHASES; p++) {
+			const float x = (float)p / BICUBIC_PHASES;
+			const float x2 = x * x, x3 = x2 * x;
+			w[p][0] = -0.5f * x3 + x2 - 0.5f * x;
+			w[p][1] = 1.5f * x3 - 2.5f * x2 + 1.0f;
+			w[p][2] = -1.5f * x3 + 2.0f * x2 + 0.5f * x;
+			w[p][3] = 0.5f * x3 - 0.5f * x2;
+		}
+	}
+};
+
+static const BicubicTable& GetBicubicTable() {
+	static const BicubicTable table;
+	return table;
+}
+
+#if defined(FELINA_SSE)
+// Weighted sum of 4 consecutive RGBA8 texels
+static inline __m128 BicubicRow(const unsigned char* p, const float* w) {
+	const __m128i z = _mm_setzero_si128();
+	const __m128i v = _mm_loadu_si128((const __m128i*)p);
+	const __m128i lo = _mm_unpacklo_epi8(v, z), hi = _mm_unpackhi_epi8(v, z);
+	__m128 acc = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, z)), _mm_set1_ps(w[0]));
+	acc = _mm_add_ps(acc, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, z)), _mm_set1_ps(w[1])));
+	acc = _mm_add_ps(acc, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, z)), _mm_set1_ps(w[2])));
+	acc = _mm_add_ps(acc, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, z)), _mm_set1_ps(w[3])));
+	return acc;
+}
+#elif defined(FELINA_NEON)
+static inline float32x4_t BicubicRow(const unsigned char* p, const float* w) {
+	const uint8x16_t v = vld1q_u8(p);
+	const uint16x8_t lo = vmovl_u8(vget_low_u8(v)), hi = vmovl_u8(vget_high_u8(v));
+	float32x4_t acc = vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo))), w[0]);
+	acc = vmlaq_n_f32(acc, vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo))), w[1]);
+	acc = vmlaq_n_f32(acc, vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi))), w[2]);
+	acc = vmlaq_n_f32(acc, vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi))), w[3]);
+	return acc;
+}
+#endif
+
+// Catmull-Rom RGBA8 fetch at texel coordinates (clamp addressing)
+static inline void BicubicRGBA8(const WarpImageDesc& src, float x, float y, unsigned char* out) {
+	const BicubicTable& table = GetBicubicTable();
+	const float flx = floorf(x), fly = floorf(y);
+	const int ix = (int)flx - 1, iy = (int)fly - 1;
+	const float* wx = table.w[(int)((x - flx) * BICUBIC_PHASES + 0.5f)];
+	const float* wy = table.w[(int)((y - fly) * BICUBIC_PHASES + 0.5f)];
+
+	// Row pointers; border texels are gathered into a clamped 4x4 block
+	const unsigned char* rows[4];
+	unsigned char block[4][16];
+	if (ix >= 0 && iy >= 0 && ix + 3 < src.width && iy + 3 < src.height) {
+		for (int r = 0; r < 4; r++) rows[r] = src.pixels + (size_t)(iy + r) * src.stride + ix * 4;
+	}
+	else {
+		for (int r = 0; r < 4; r++) {
+			int yy = iy + r;
+			yy = yy < 0 ? 0 : (yy >= src.height ? src.height - 1 : yy);
+			const unsigned char* row = src.pixels + (size_t)yy * src.stride;
+			for (int c = 0; c < 4; c++) {
+				int xx = ix + c;
+				xx = xx < 0 ? 0 : (xx >= src.width ? src.width - 1 : xx);
+				memcpy(block[r] + c * 4, row + xx * 4, 4);
+			}
+			rows[r] = block[r];
+		}
+	}
+
+#if defined(FELINA_SSE)
+	__m128 v = _mm_mul_ps(BicubicRow(rows[0], wx), _mm_set1_ps(wy[0]));
+	v = _mm_add_ps(v, _mm_mul_ps(BicubicRow(rows[1], wx), _mm_set1_ps(wy[1])));
+	v = _mm_add_ps(v, _mm_mul_ps(BicubicRow(rows[2], wx), _mm_set1_ps(wy[2])));
+	v = _mm_add_ps(v, _mm_mul_ps(BicubicRow(rows[3], wx), _mm_set1_ps(wy[3])));
+	__m128i i = _mm_cvtps_epi32(v);
+	i = _mm_packs_epi32(i, i);
+	i = _mm_packus_epi16(i, i); // Catmull-Rom overshoot saturates to [0, 255]
+	const int packed = _mm_cvtsi128_si32(i);
+	memcpy(out, &packed, 4);
+#elif defined(FELINA_NEON)
+	float32x4_t v = vmulq_n_f32(BicubicRow(rows[0], wx), wy[0]);
+	v = vmlaq_n_f32(v, BicubicRow(rows[1], wx), wy[1]);
+	v = vmlaq_n_f32(v, BicubicRow(rows[2], wx), wy[2]);
+	v = vmlaq_n_f32(v, BicubicRow(rows[3], wx), wy[3]);
+	const int16x4_t n16 = vqmovn_s32(vcvtnq_s32_f32(v));
+	const uint8x8_t n8 = vqmovun_s16(vcombine_s16(n16, n16));
+	vst1_lane_u32((uint32_t*)out, vreinterpret_u32_u8(n8), 0);
+#else
+	for (int c = 0; c < 4; c++) {
+		float v = 0.0f;
+		for (int r = 0; r < 4; r++) {
+			const unsigned char* p = rows[r] + c;
+			v += wy[r] * (wx[0] * p[0] + wx[1] * p[4] + wx[2] * p[8] + wx[3] * p[12]);
+		}
+		v += 0.5f;
+		out[c] = (unsigned char)(v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v));
+	}
+#endif
+}
+
+// --- FIXED-POINT BILINEAR ---
+// 16.16 source coordinates and 8-bit weights. Each lerp is (a << 8) + (b - a) * w, rounded
+// back to 8 bits ((v + 128) >> 8, NEON vrshrn); every intermediate fits 16 bits, so SSE2,
+// NEON and the scalar path produce identical bytes. The clamp keeps the 2x2 footprint inside
+// the image (weights 0..255: at most 1/256 texel short of the last texel centre).
+
+static inline int LerpFixed(int a, int b, int w) {
+	return ((a << 8) + (b - a) * w + 128) >> 8;
+}
+
+static inline void BilinearFixedRGBA8(const WarpImageDesc& src, int x, int y, unsigned char* out) {
+	const int fx = (x >> 8) & 255, fy = (y >> 8) & 255;
+	const unsigned char* r0 = src.pixels + (size_t)(y >> 16) * src.stride + (x >> 16) * 4;
+	const unsigned char* r1 = r0 + src.stride;
+	for (int c = 0; c < 4; c++) {
+		const int top = LerpFixed(r0[c], r0[c + 4], fx);
+		const int bot = LerpFixed(r1[c], r1[c + 4], fx);
+		out[c] = (unsigned char)LerpFixed(top, bot, fy);
+	}
+}
+
+#if defined(FELINA_SSE)
+// 8 channels (2 pixels) of 16-bit lanes; wrap-around is harmless, the result fits
+static inline __m128i LerpFixed8(__m128i a, __m128i b, __m128i w) {
+	const __m128i v = _mm_add_epi16(_mm_slli_epi16(a, 8), _mm_mullo_epi16(_mm_sub_epi16(b, a), w));
+	return _mm_srli_epi16(_mm_add_epi16(v, _mm_set1_epi16(128)), 8);
+}
+#elif defined(FELINA_NEON)
+// (a << 8) - a * w + b * w, rounded and narrowed
+static inline uint8x8_t LerpFixed8(uint8x8_t a, uint8x8_t b, uint8x8_t w) {
+	return vrshrn_n_u16(vmlal_u8(vmlsl_u8(vshll_n_u8(a, 8), a, w), b, w), 8);
+}
+#endif
+
+// 4 pixels per iteration: one 8-byte load fetches a pixel's left and right texels of a row
+static inline void BilinearFixed4(const WarpImageDesc& src, const int* x, const int* y, unsigned char* out) {
+#if defined(FELINA_SSE)
+	const __m128i z = _mm_setzero_si128();
+	__m128i t[4], b[4];
+	for (int j = 0; j < 4; j++) {
+		const unsigned char* r0 = src.pixels + (size_t)(y[j] >> 16) * src.stride + (x[j] >> 16) * 4;
+		t[j] = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)r0), z);              // tl | tr
+		b[j] = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(r0 + src.stride)), z); // bl | br
+	}
+
+	// Weights splatted over each pixel's 4 channel lanes
+	const __m128i mask = _mm_set1_epi32(255);
+	__m128i wx = _mm_and_si128(_mm_srli_epi32(_mm_loadu_si128((const __m128i*)x), 8), mask);
+	__m128i wy = _mm_and_si128(_mm_srli_epi32(_mm_loadu_si128((const __m128i*)y), 8), mask);
+	wx = _mm_packs_epi32(wx, wx); wx = _mm_unpacklo_epi16(wx, wx);
+	wy = _mm_packs_epi32(wy, wy); wy = _mm_unpacklo_epi16(wy, wy);
+	const __m128i wxLo = _mm_unpacklo_epi32(wx, wx), wxHi = _mm_unpackhi_epi32(wx, wx);
+	const __m128i wyLo = _mm_unpacklo_epi32(wy, wy), wyHi = _mm_unpackhi_epi32(wy, wy);
+
+	const __m128i topLo = LerpFixed8(_mm_unpacklo_epi64(t[0], t[1]), _mm_unpackhi_epi64(t[0], t[1]), wxLo);
+	const __m128i topHi = LerpFixed8(_mm_unpacklo_epi64(t[2], t[3]), _mm_unpackhi_epi64(t[2], t[3]), wxHi);
+	const __m128i botLo = LerpFixed8(_mm_unpacklo_epi64(b[0], b[1]), _mm_unpackhi_epi64(b[0], b[1]), wxLo);
+	const __m128i botHi = LerpFixed8(_mm_unpacklo_epi64(b[2], b[3]), _mm_unpackhi_epi64(b[2], b[3]), wxHi);
+	_mm_storeu_si128((__m128i*)out, _mm_packus_epi16(LerpFixed8(topLo, botLo, wyLo), LerpFixed8(topHi, botHi, wyHi)));
+#elif defined(FELINA_NEON)
+	uint8x8_t t[4], b[4];
+	for (int j = 0; j < 4; j++) {
+		const unsigned char* r0 = src.pixels + (size_t)(y[j] >> 16) * src.stride + (x[j] >> 16) * 4;
+		t[j] = vld1_u8(r0);              // tl | tr
+		b[j] = vld1_u8(r0 + src.stride); // bl | br
+	}
+
+	// Weight bytes splatted over each pixel's 4 channels
+	const uint32x4_t splat = vdupq_n_u32(0x01010101u);
+	const uint8x16_t wx = vreinterpretq_u8_u32(vmulq_u32(vandq_u32(vshrq_n_u32(vld1q_u32((const uint32_t*)x), 8), vdupq_n_u32(255)), splat));
+	const uint8x16_t wy = vreinterpretq_u8_u32(vmulq_u32(vandq_u32(vshrq_n_u32(vld1q_u32((const uint32_t*)y), 8), vdupq_n_u32(255)), splat));
+
+	// Transpose to [left texels of 2 pixels] / [right texels of 2 pixels]
+	const uint32x2x2_t t01 = vtrn_u32(vreinterpret_u32_u8(t[0]), vreinterpret_u32_u8(t[1]));
+	const uint32x2x2_t t23 = vtrn_u32(vreinterpret_u32_u8(t[2]), vreinterpret_u32_u8(t[3]));
+	const uint32x2x2_t b01 = vtrn_u32(vreinterpret_u32_u8(b[0]), vreinterpret_u32_u8(b[1]));
+	const uint32x2x2_t b23 = vtrn_u32(vreinterpret_u32_u8(b[2]), vreinterpret_u32_u8(b[3]));
+
+	const uint8x8_t topLo = LerpFixed8(vreinterpret_u8_u32(t01.val[0]), vreinterpret_u8_u32(t01.val[1]), vget_low_u8(wx));
+	const uint8x8_t topHi = LerpFixed8(vreinterpret_u8_u32(t23.val[0]), vreinterpret_u8_u32(t23.val[1]), vget_high_u8(wx));
+	const uint8x8_t botLo = LerpFixed8(vreinterpret_u8_u32(b01.val[0]), vreinterpret_u8_u32(b01.val[1]), vget_low_u8(wx));
+	const uint8x8_t botHi = LerpFixed8(vreinterpret_u8_u32(b23.val[0]), vreinterpret_u8_u32(b23.val[1]), vget_high_u8(wx));
+	vst1q_u8(out, vcombine_u8(LerpFixed8(topLo, botLo, vget_low_u8(wy)), LerpFixed8(topHi, botHi, vget_high_u8(wy))));
+#else
+	for (int j = 0; j < 4; j++) BilinearFixedRGBA8(src, x[j], y[j], out + j * 4);
+#endif
+}
+
+// --- SAMPLERS ---
+// Coordinates of pixels behind the camera are WARP_BEHIND (below every sampler's clamp range).
+
+static const float WARP_BEHIND = -1e30f;
+
+typedef void (*WarpFetch)(const WarpImageDesc&, float, float, unsigned char*);
+
+template <WarpFetch Fetch>
+static inline void SampleRowPixels(const WarpImageDesc& src, const float* xs, const float* ys, int n, unsigned char* out) {
+	for (int k = 0; k < n; k++) {
+		if (xs[k] == WARP_BEHIND) memset(out + k * 4, 0, 4);
+		else Fetch(src, xs[k], ys[k], out + k * 4);
+	}
+}
+
+struct BilinearSampler {
+	// saturate(uv) == clamp to the outer texel centres for a 2x2 footprint
+	static float MinCoord() { return 0.0f; }
+	static float MaxCoord(int size) { return (float)(size - 1); }
+	static void SampleRow(const WarpImageDesc& src, const float* xs, const float* ys, int n, unsigned char* out) {
+		SampleRowPixels<BilinearRGBA8>(src, xs, ys, n, out);
+	}
+};
+
+struct BicubicSampler {
+	// saturate(uv) keeps uv * size - 0.5 within [-0.5, size - 0.5]
+	static float MinCoord() { return -0.5f; }
+	static float MaxCoord(int size) { return size - 0.5f; }
+	static void SampleRow(const WarpImageDesc& src, const float* xs, const float* ys, int n, unsigned char* out) {
+		SampleRowPixels<BicubicRGBA8>(src, xs, ys, n, out);
+	}
+};
+
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+// 4 float coordinates -> clamped 16.16; returns non-zero if any pixel is behind the camera
+// (those lanes clamp to 0 and are cleared afterwards)
+static inline int FixedCoords4(const float* xs, const float* ys, int maxX, int maxY, int* fx, int* fy) {
+#if defined(FELINA_SSE)
+	const __m128 scale = _mm_set1_ps(65536.0f), half = _mm_set1_ps(0.5f);
+	const __m128 vx = _mm_loadu_ps(xs), vy = _mm_loadu_ps(ys);
+	const __m128i z = _mm_setzero_si128();
+	const __m128i vMaxX = _mm_set1_epi32(maxX), vMaxY = _mm_set1_epi32(maxY);
+	__m128i ix = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(vx, scale), half));
+	__m128i iy = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(vy, scale), half));
+	ix = _mm_and_si128(ix, _mm_cmpgt_epi32(ix, z));
+	iy = _mm_and_si128(iy, _mm_cmpgt_epi32(iy, z));
+	const __m128i mx = _mm_cmpgt_epi32(ix, vMaxX), my = _mm_cmpgt_epi32(iy, vMaxY);
+	_mm_storeu_si128((__m128i*)fx, _mm_or_si128(_mm_and_si128(mx, vMaxX), _mm_andnot_si128(mx, ix)));
+	_mm_storeu_si128((__m128i*)fy, _mm_or_si128(_mm_and_si128(my, vMaxY), _mm_andnot_si128(my, iy)));
+	return _mm_movemask_ps(_mm_cmpeq_ps(vx, _mm_set1_ps(WARP_BEHIND)));
+#else
+	const float32x4_t vx = vld1q_f32(xs), vy = vld1q_f32(ys);
+	const int32x4_t z = vdupq_n_s32(0);
+	const int32x4_t ix = vcvtq_s32_f32(vmlaq_n_f32(vdupq_n_f32(0.5f), vx, 65536.0f));
+	const int32x4_t iy = vcvtq_s32_f32(vmlaq_n_f32(vdupq_n_f32(0.5f), vy, 65536.0f));
+	vst1q_s32(fx, vminq_s32(vmaxq_s32(ix, z), vdupq_n_s32(maxX)));
+	vst1q_s32(fy, vminq_s32(vmaxq_s32(iy, z), vdupq_n_s32(maxY)));
+	return (int)vmaxvq_u32(vceqq_f32(vx, vdupq_n_f32(WARP_BEHIND)));
+#endif
+}
+#endif
+
+struct BilinearFixedSampler {
+	static float MinCoord() { return 0.0f; }
+	static float MaxCoord(int size) { return (float)(size - 1); }
+	static void SampleRow(const WarpImageDesc& src, const float* xs, const float* ys, int n, unsigned char* out) {
+		const int maxX = ((src.width - 1) << 16) - 1, maxY = ((src.height - 1) << 16) - 1;
+		int k = 0;
+
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+		int fx[4], fy[4];
+		for (; k + 4 <= n; k += 4) {
+			unsigned char* o = out + k * 4;
+			const int behind = FixedCoords4(xs + k, ys + k, maxX, maxY, fx, fy);
+			BilinearFixed4(src, fx, fy, o);
+			if (behind) {
+				for (int j = 0; j < 4; j++) if (xs[k + j] == WARP_BEHIND) memset(o + j * 4, 0, 4);
+			}
+		}
+#endif
+
+		for (; k < n; k++) {
+			if (xs[k] == WARP_BEHIND) { memset(out + k * 4, 0, 4); continue; }
+			const int ix = (int)(xs[k] * 65536.0f + 0.5f), iy = (int)(ys[k] * 65536.0f + 0.5f);
+			BilinearFixedRGBA8(src, ix < maxX ? ix : maxX, iy < maxY ? iy : maxY, out + k * 4);
+		}
+	}
+};
+
+// --- SCANLINE SPANS ---
+// Along a row the source coordinate is u(t) = (a + b t) / (c + d t), whose second derivative
+// is |u''| = 2 |d| |a d - b c| / |c + d t|^3. Interpolating linearly between exact samples L
+// pixels apart is off by at most L^2 / 8 * max|u''|, so for a tolerance e the span length is
+// sqrt(8 e / max|u''|). Fronto-parallel captures (d ~ 0) get one span per tile row, i.e. two
+// divides. Returns 0 when the row crosses w <= 0 and must take the exact path.
+static int SpanLength(const float* g, float rx, float ry, float rw, int width, float maxError) {
+	const float w0 = rw, w1 = rw + g[6] * width;
+	if (w0 <= 1e-8f || w1 <= 1e-8f) return 0;
+
+	const float wMin = w0 < w1 ? w0 : w1;
+	const float kx = fabsf(rx * g[6] - g[0] * rw);
+	const float ky = fabsf(ry * g[6] - g[3] * rw);
+	const float curvature = 2.0f * fabsf(g[6]) * (kx > ky ? kx : ky) / (wMin * wMin * wMin);
+
+	if (curvature * width * width <= 8.0f * maxError) return width;
+	const int span = (int)sqrtf(8.0f * maxError / curvature);
+	return span < 1 ? 1 : span;
+}
+
+// Source texel coordinates of output pixels [x0, x0 + w) of row y, clamped to
+// [minC, maxX] x [minC, maxY]
+static void WarpRowCoords(const WarpParams& p, int x0, int y, int w, float minC, float maxX, float maxY, float* xs, float* ys) {
+	const float* g = p.g;
+	const float rx = g[0] * x0 + g[1] * y + g[2];
+	const float ry = g[3] * x0 + g[4] * y + g[5];
+	const float rw = g[6] * x0 + g[7] * y + g[8];
+	int x = 0;
+
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+	static const float ramp[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+	const Vec4f lane = V4Load(ramp);
+	const Vec4f vMin = V4Set(minC);
+	const Vec4f vMaxX = V4Set(maxX), vMaxY = V4Set(maxY);
+#endif
+
+	// Piecewise-affine spans: exact (renormalised) endpoints, stepped coordinates between
+	const int span = p.maxError > 0.0f ? SpanLength(g, rx, ry, rw, w, p.maxError) : 0;
+	if (span > 0) {
+		float sx = rx / rw, sy = ry / rw;
+		for (int s0 = 0; s0 < w; s0 += span) {
+			const int s1 = s0 + span < w ? s0 + span : w;
+			const float hw = rw + g[6] * s1;
+			const float ex = (rx + g[0] * s1) / hw, ey = (ry + g[3] * s1) / hw;
+			const float inv = 1.0f / (s1 - s0);
+			const float dx = (ex - sx) * inv, dy = (ey - sy) * inv;
+			int k = s0;
+
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+			for (; k + 4 <= s1; k += 4) {
+				const Vec4f t = V4Add(V4Set((float)(k - s0)), lane);
+				V4Store(xs + k, V4Min(V4Max(V4Add(V4Set(sx), V4Mul(V4Set(dx), t)), vMin), vMaxX));
+				V4Store(ys + k, V4Min(V4Max(V4Add(V4Set(sy), V4Mul(V4Set(dy), t)), vMin), vMaxY));
+			}
+#endif
+
+			for (; k < s1; k++) {
+				const float cx = sx + dx * (k - s0), cy = sy + dy * (k - s0);
+				xs[k] = cx < minC ? minC : (cx > maxX ? maxX : cx);
+				ys[k] = cy < minC ? minC : (cy > maxY ? maxY : cy);
+			}
+			sx = ex; sy = ey;
+		}
+		return;
+	}
+
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+	float ws[4];
+	for (; x + 4 <= w; x += 4) {
+		const Vec4f vx = V4Add(V4Set((float)x), lane);
+		const Vec4f hx = V4Add(V4Set(rx), V4Mul(V4Set(g[0]), vx));
+		const Vec4f hy = V4Add(V4Set(ry), V4Mul(V4Set(g[3]), vx));
+		const Vec4f hw = V4Add(V4Set(rw), V4Mul(V4Set(g[6]), vx));
+
+		V4Store(xs + x, V4Min(V4Max(V4Div(hx, hw), vMin), vMaxX));
+		V4Store(ys + x, V4Min(V4Max(V4Div(hy, hw), vMin), vMaxY));
+		V4Store(ws, hw);
+		for (int k = 0; k < 4; k++) if (ws[k] <= 1e-8f) xs[x + k] = WARP_BEHIND; // behind the camera
+	}
+#endif
+
+	for (; x < w; x++) {
+		const float hw = rw + g[6] * x;
+		if (hw <= 1e-8f) { xs[x] = WARP_BEHIND; ys[x] = 0.0f; continue; }
+		const float sx = (rx + g[0] * x) / hw, sy = (ry + g[3] * x) / hw;
+		xs[x] = sx < minC ? minC : (sx > maxX ? maxX : sx);
+		ys[x] = sy < minC ? minC : (sy > maxY ? maxY : sy);
+	}
+}
+
+// --- COMPOSITE (ARColoringComposite) ---
+// col.rgb = smoothstep(0.1, _WhitePoint, col.rgb); return col * ref;
+// Applied to each warped tile row while it is still in L1, so the fused pass reads the source
+// and the reference once and writes the result once. The smoothstep becomes a 256-entry curve
+// on 8-bit input and the products are rounded exactly: (a * b + 127) / 255.
+
+struct CompositeParams {
+	WarpImageDesc ref;              // _RefTex
+	bool refMatchesDst;             // Same size as the output: streamed texel for texel
+	float refScaleX, refScaleY;     // Output pixel -> reference texel otherwise
+	float whitePoint;               // _WhitePoint (> 0.1)
+	unsigned char curve[256];       // Paper white curve for 8-bit input
+};
+
+static void BuildWhiteCurve(float whitePoint, unsigned char* curve) {
+	for (int i = 0; i < 256; i++) {
+		float t = (i / 255.0f - 0.1f) / (whitePoint - 0.1f);
+		t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+		curve[i] = (unsigned char)(t * t * (3.0f - 2.0f * t) * 255.0f + 0.5f);
+	}
+}
+
+static inline int MulDiv255(int a, int b) {
+	const int t = a * b + 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+// Reference texels under output pixels [x0, x0 + n) of row y: the reference row itself, or
+// 'resampled' (WARP_TILE texels) filled at the output UV
+static const unsigned char* CompositeRefRow(const CompositeParams& c, int x0, int y, int n, unsigned char* resampled) {
+	if (c.refMatchesDst) return c.ref.pixels + (size_t)y * c.ref.stride + x0 * 4;
+
+	const float maxX = (float)(c.ref.width - 1), maxY = (float)(c.ref.height - 1);
+	float ry = (y + 0.5f) * c.refScaleY - 0.5f;
+	ry = ry < 0.0f ? 0.0f : (ry > maxY ? maxY : ry);
+	for (int k = 0; k < n; k++) {
+		float rx = (x0 + k + 0.5f) * c.refScaleX - 0.5f;
+		rx = rx < 0.0f ? 0.0f : (rx > maxX ? maxX : rx);
+		BilinearRGBA8(c.ref, rx, ry, resampled + k * 4);
+	}
+	return resampled;
+}
+
+// Composite output pixels [x0, x0 + n) of row y in place (n <= WARP_TILE)
+static void CompositeRow(const CompositeParams& c, int x0, int y, int n, unsigned char* out) {
+	// 1. Reference texels of this row segment
+	unsigned char resampled[WARP_TILE * 4];
+	const unsigned char* ref = CompositeRefRow(c, x0, y, n, resampled);
+
+	// 2. Paper white on RGB (alpha passes through)
+	for (int k = 0; k < n; k++) {
+		unsigned char* o = out + k * 4;
+		o[0] = c.curve[o[0]]; o[1] = c.curve[o[1]]; o[2] = c.curve[o[2]];
+	}
+
+	// 3. col * ref
+	int k = 0;
+#if defined(FELINA_SSE)
+	const __m128i z = _mm_setzero_si128(), half = _mm_set1_epi16(128);
+	for (; k + 4 <= n; k += 4) {
+		const __m128i a = _mm_loadu_si128((const __m128i*)(out + k * 4));
+		const __m128i b = _mm_loadu_si128((const __m128i*)(ref + k * 4));
+		__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, z), _mm_unpacklo_epi8(b, z)), half);
+		__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, z), _mm_unpackhi_epi8(b, z)), half);
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+		_mm_storeu_si128((__m128i*)(out + k * 4), _mm_packus_epi16(lo, hi));
+	}
+#elif defined(FELINA_NEON)
+	for (; k + 4 <= n; k += 4) {
+		const uint8x16_t a = vld1q_u8(out + k * 4), b = vld1q_u8(ref + k * 4);
+		const uint16x8_t lo = vmull_u8(vget_low_u8(a), vget_low_u8(b));
+		const uint16x8_t hi = vmull_u8(vget_high_u8(a), vget_high_u8(b));
+		vst1q_u8(out + k * 4, vcombine_u8(vrshrn_n_u16(vrsraq_n_u16(lo, lo, 8), 8), vrshrn_n_u16(vrsraq_n_u16(hi, hi, 8), 8)));
+	}
+#endif
+
+	for (; k < n; k++) {
+		for (int ch = 0; ch < 4; ch++) out[k * 4 + ch] = (unsigned char)MulDiv255(out[k * 4 + ch], ref[k * 4 + ch]);
+	}
+}
+
+// --- HALF FLOAT (ARGBHalf) ---
+// Texels are 4 binary16 values, nominally [0, 1] and never clamped (Catmull-Rom overshoot is
+// kept, as in an ARGBHalf render texture). Per tile row the filter taps are gathered as halves,
+// converted with one HalfToFloatRow call, filtered and composited in float and written back
+// with one FloatToHalfRow, so nothing larger than a row segment is held as float32. Pixels
+// behind the camera gather zero taps and so come out as transparent black.
+
+struct BilinearHalfSampler {
+	static float MinCoord() { return 0.0f; }
+	static float MaxCoord(int size) { return (float)(size - 1); }
+	static void SampleRow(const WarpImageDesc& src, const float* xs, const float* ys, int n, float* out) {
+		// 1. 2x2 footprints: tl, tr, bl, br
+		unsigned short taps[WARP_TILE * 16];
+		float f[WARP_TILE * 16], fx[WARP_TILE], fy[WARP_TILE];
+		for (int k = 0; k < n; k++) {
+			unsigned short* t = taps + k * 16;
+			if (xs[k] == WARP_BEHIND) { memset(t, 0, 32); fx[k] = fy[k] = 0.0f; continue; }
+			int ix = (int)xs[k], iy = (int)ys[k];
+			if (ix > src.width - 2) ix = src.width - 2;
+			if (iy > src.height - 2) iy = src.height - 2;
+			fx[k] = xs[k] - ix; fy[k] = ys[k] - iy;
+			const unsigned char* r0 = src.pixels + (size_t)iy * src.stride + ix * HALF_TEXEL_BYTES;
+			memcpy(t, r0, 16);
+			memcpy(t + 8, r0 + src.stride, 16);
+		}
+		HalfToFloatRow(taps, f, n * 16);
+
+		// 2. Blend
+		for (int k = 0; k < n; k++) {
+			const float* q = f + k * 16;
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+			const Vec4f vfx = V4Set(fx[k]), vfy = V4Set(fy[k]);
+			const Vec4f p00 = V4Load(q), p01 = V4Load(q + 4), p10 = V4Load(q + 8), p11 = V4Load(q + 12);
+			const Vec4f top = V4Add(p00, V4Mul(V4Sub(p01, p00), vfx));
+			const Vec4f bot = V4Add(p10, V4Mul(V4Sub(p11, p10), vfx));
+			V4Store(out + k * 4, V4Add(top, V4Mul(V4Sub(bot, top), vfy)));
+#else
+			for (int c = 0; c < 4; c++) {
+				const float top = q[c] + (q[c + 4] - q[c]) * fx[k];
+				const float bot = q[c + 8] + (q[c + 12] - q[c + 8]) * fx[k];
+				out[k * 4 + c] = top + (bot - top) * fy[k];
+			}
+#endif
+		}
+	}
+};
+
+struct BicubicHalfSampler {
+	static float MinCoord() { return -0.5f; }
+	static float MaxCoord(int size) { return size - 0.5f; }
+	static void SampleRow(const WarpImageDesc& src, const float* xs, const float* ys, int n, float* out) {
+		const BicubicTable& table = GetBicubicTable();
+
+		// 1. 4x4 footprints, row by row (clamp addressing at the border)
+		unsigned short taps[WARP_TILE * 64];
+		float f[WARP_TILE * 64];
+		const float* wx[WARP_TILE];
+		const float* wy[WARP_TILE];
+		for (int k = 0; k < n; k++) {
+			unsigned short* t = taps + k * 64;
+			if (xs[k] == WARP_BEHIND) { memset(t, 0, 128); wx[k] = wy[k] = table.w[0]; continue; }
+			const float flx = floorf(xs[k]), fly = floorf(ys[k]);
+			const int ix = (int)flx - 1, iy = (int)fly - 1;
+			wx[k] = table.w[(int)((xs[k] - flx) * BICUBIC_PHASES + 0.5f)];
+			wy[k] = table.w[(int)((ys[k] - fly) * BICUBIC_PHASES + 0.5f)];
+			if (ix >= 0 && iy >= 0 && ix + 3 < src.width && iy + 3 < src.height) {
+				for (int r = 0; r < 4; r++) memcpy(t + r * 16, src.pixels + (size_t)(iy + r) * src.stride + ix * HALF_TEXEL_BYTES, 32);
+				continue;
+			}
+			for (int r = 0; r < 4; r++) {
+				int yy = iy + r;
+				yy = yy < 0 ? 0 : (yy >= src.height ? src.height - 1 : yy);
+				const unsigned char* row = src.pixels + (size_t)yy * src.stride;
+				for (int c = 0; c < 4; c++) {
+					int xx = ix + c;
+					xx = xx < 0 ? 0 : (xx >= src.width ? src.width - 1 : xx);
+					memcpy(t + r * 16 + c * 4, row + xx * HALF_TEXEL_BYTES, HALF_TEXEL_BYTES);
+				}
+			}
+		}
+		HalfToFloatRow(taps, f, n * 64);
+
+		// 2. Separable weights on 4-channel vectors
+		for (int k = 0; k < n; k++) {
+			const float* q = f + k * 64;
+			const float* u = wx[k];
+			const float* v = wy[k];
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+			Vec4f acc = V4Set(0.0f);
+			for (int r = 0; r < 4; r++) {
+				const float* t = q + r * 16;
+				Vec4f row = V4Mul(V4Load(t), V4Set(u[0]));
+				row = V4Add(row, V4Mul(V4Load(t + 4), V4Set(u[1])));
+				row = V4Add(row, V4Mul(V4Load(t + 8), V4Set(u[2])));
+				row = V4Add(row, V4Mul(V4Load(t + 12), V4Set(u[3])));
+				acc = V4Add(acc, V4Mul(row, V4Set(v[r])));
+			}
+			V4Store(out + k * 4, acc);
+#else
+			for (int c = 0; c < 4; c++) {
+				float acc = 0.0f;
+				for (int r = 0; r < 4; r++) {
+					const float* t = q + r * 16 + c;
+					acc += v[r] * (u[0] * t[0] + u[1] * t[4] + u[2] * t[8] + u[3] * t[12]);
+				}
+				out[k * 4 + c] = acc;
+			}
+#endif
+		}
+	}
+};
+
+// CompositeRow for float pixels in [0, 1]: the smoothstep is evaluated instead of tabulated
+static void CompositeRowFloat(const CompositeParams& c, int x0, int y, int n, float* out) {
+	unsigned char resampled[WARP_TILE * 4];
+	const unsigned char* ref = CompositeRefRow(c, x0, y, n, resampled);
+	const float scale = 1.0f / (c.whitePoint - 0.1f), unit = 1.0f / 255.0f;
+	int k = 0;
+
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+	// smoothstep on all 4 lanes, then alpha is taken from the input again
+	static const float rgbMask[4] = { 1.0f, 1.0f, 1.0f, 0.0f }, alphaMask[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	const Vec4f mRgb = V4Load(rgbMask), mAlpha = V4Load(alphaMask);
+	const Vec4f lo = V4Set(0.1f), vScale = V4Set(scale), zero = V4Set(0.0f), one = V4Set(1.0f);
+	const Vec4f two = V4Set(2.0f), three = V4Set(3.0f);
+	for (; k < n; k++) {
+		float* o = out + k * 4;
+		const unsigned char* r = ref + k * 4;
+		const float rf[4] = { r[0] * unit, r[1] * unit, r[2] * unit, r[3] * unit };
+		const Vec4f col = V4Load(o);
+		const Vec4f t = V4Min(V4Max(V4Mul(V4Sub(col, lo), vScale), zero), one);
+		const Vec4f smooth = V4Mul(V4Mul(t, t), V4Sub(three, V4Mul(two, t)));
+		V4Store(o, V4Mul(V4Add(V4Mul(smooth, mRgb), V4Mul(col, mAlpha)), V4Load(rf)));
+	}
+#endif
+
+	for (; k < n; k++) {
+		float* o = out + k * 4;
+		const unsigned char* r = ref + k * 4;
+		for (int ch = 0; ch < 3; ch++) {
+			float t = (o[ch] - 0.1f) * scale;
+			t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+			o[ch] = t * t * (3.0f - 2.0f * t) * (r[ch] * unit);
+		}
+		o[3] *= r[3] * unit;
+	}
+}
+
+// --- YUV 4:2:0 INGESTION ---
+// Camera frames arrive as a full-resolution luma plane and half-resolution chroma (NV12:
+// interleaved UV, NV21: VU, I420: separate planes), described like YUV_420_888 / XRCpuImage
+// planes by a row stride and a pixel stride. Luma and chroma are sampled bilinearly at each
+// output pixel's source position and only those samples are converted to RGB, so no RGB frame
+// is ever built and the camera texels outside the page are never read. The 2x2 footprints are
+// gathered as packed bytes; blending and conversion run on 4 pixels at a time.
+
+struct YuvPlanes {
+	const unsigned char* u;
+	const unsigned char* v;
+	int width, height;              // Chroma size
+	int rowStride, pixelStride;     // Bytes; pixelStride 2 = interleaved (NV12 / NV21)
+	float ys, yo, rv, gu, gv, bu;   // R = ys (Y - yo) + rv V', G = .. - gu U' - gv V', B = .. + bu U'
+};
+
+// 2x2 texels at (x, y) as tl | tr << 8 | bl << 16 | br << 24
+static inline unsigned int PlaneQuad(const unsigned char* plane, int rowStride, int pixelStride, int x, int y) {
+	const unsigned char* r0 = plane + (size_t)y * rowStride + x * pixelStride;
+	const unsigned char* r1 = r0 + rowStride;
+	return r0[0] | (r0[pixelStride] << 8) | (r1[0] << 16) | ((unsigned int)r1[pixelStride] << 24);
+}
+
+// Bilinear blend of a packed quad with 16.16 fractions (scalar)
+static inline float QuadLerp(unsigned int q, int x, int y) {
+	const float fx = (x & 0xFFFF) * (1.0f / 65536.0f), fy = (y & 0xFFFF) * (1.0f / 65536.0f);
+	const float tl = (float)(q & 255), tr = (float)((q >> 8) & 255);
+	const float bl = (float)((q >> 16) & 255), br = (float)(q >> 24);
+	const float top = tl + (tr - tl) * fx, bot = bl + (br - bl) * fx;
+	return top + (bot - top) * fy;
+}
+
+#if defined(FELINA_SSE)
+static inline __m128 QuadLerp4(__m128i q, __m128i x, __m128i y) {
+	const __m128i m8 = _mm_set1_epi32(255), m16 = _mm_set1_epi32(0xFFFF);
+	const __m128 scale = _mm_set1_ps(1.0f / 65536.0f);
+	const __m128 fx = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(x, m16)), scale);
+	const __m128 fy = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(y, m16)), scale);
+	const __m128 tl = _mm_cvtepi32_ps(_mm_and_si128(q, m8));
+	const __m128 tr = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(q, 8), m8));
+	const __m128 bl = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(q, 16), m8));
+	const __m128 br = _mm_cvtepi32_ps(_mm_srli_epi32(q, 24));
+	const __m128 top = _mm_add_ps(tl, _mm_mul_ps(_mm_sub_ps(tr, tl), fx));
+	const __m128 bot = _mm_add_ps(bl, _mm_mul_ps(_mm_sub_ps(br, bl), fx));
+	return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bot, top), fy));
+}
+#elif defined(FELINA_NEON)
+static inline float32x4_t QuadLerp4(uint32x4_t q, int32x4_t x, int32x4_t y) {
+	const uint32x4_t m8 = vdupq_n_u32(255), m16 = vdupq_n_u32(0xFFFF);
+	const float32x4_t fx = vmulq_n_f32(vcvtq_f32_u32(vandq_u32(vreinterpretq_u32_s32(x), m16)), 1.0f / 65536.0f);
+	const float32x4_t fy = vmulq_n_f32(vcvtq_f32_u32(vandq_u32(vreinterpretq_u32_s32(y), m16)), 1.0f / 65536.0f);
+	const float32x4_t tl = vcvtq_f32_u32(vandq_u32(q, m8));
+	const float32x4_t tr = vcvtq_f32_u32(vandq_u32(vshrq_n_u32(q, 8), m8));
+	const float32x4_t bl = vcvtq_f32_u32(vandq_u32(vshrq_n_u32(q, 16), m8));
+	const float32x4_t br = vcvtq_f32_u32(vshrq_n_u32(q, 24));
+	const float32x4_t top = vmlaq_f32(tl, vsubq_f32(tr, tl), fx);
+	const float32x4_t bot = vmlaq_f32(bl, vsubq_f32(br, bl), fx);
+	return vmlaq_f32(top, vsubq_f32(bot, top), fy);
+}
+#endif
+
+// Sample and convert output pixels of one row segment (luma coordinates clamped to [0, size - 1])
+static void SampleRowYuv(const WarpImageDesc& luma, const YuvPlanes& c, const float* xs, const float* ys, int n, unsigned char* out) {
+	const int maxX = ((luma.width - 1) << 16) - 1, maxY = ((luma.height - 1) << 16) - 1;
+	const int maxCX = ((c.width - 1) << 16) - 1, maxCY = ((c.height - 1) << 16) - 1;
+	int fx[WARP_TILE], fy[WARP_TILE], cx[WARP_TILE], cy[WARP_TILE];
+	unsigned int qy[WARP_TILE], qu[WARP_TILE], qv[WARP_TILE];
+	int k = 0;
+
+	// 1. Luma 16.16 coordinates
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+	for (; k + 4 <= n; k += 4) FixedCoords4(xs + k, ys + k, maxX, maxY, fx + k, fy + k);
+#endif
+	for (; k < n; k++) {
+		// Behind the camera: gather texel 0 (zeroed in step 4) rather than convert -1e30
+		if (xs[k] == WARP_BEHIND) { fx[k] = fy[k] = 0; continue; }
+		const int ix = (int)(xs[k] * 65536.0f + 0.5f), iy = (int)(ys[k] * 65536.0f + 0.5f);
+		fx[k] = ix < 0 ? 0 : (ix < maxX ? ix : maxX);
+		fy[k] = iy < 0 ? 0 : (iy < maxY ? iy : maxY);
+	}
+
+	// 2. Gather; chroma texel centres sit at luma 2 i + 0.5, so c = x / 2 - 0.25
+	for (k = 0; k < n; k++) {
+		int x = (fx[k] >> 1) - 0x4000, y = (fy[k] >> 1) - 0x4000;
+		cx[k] = x = x < 0 ? 0 : (x > maxCX ? maxCX : x);
+		cy[k] = y = y < 0 ? 0 : (y > maxCY ? maxCY : y);
+		qy[k] = PlaneQuad(luma.pixels, luma.stride, 1, fx[k] >> 16, fy[k] >> 16);
+		qu[k] = PlaneQuad(c.u, c.rowStride, c.pixelStride, x >> 16, y >> 16);
+		qv[k] = PlaneQuad(c.v, c.rowStride, c.pixelStride, x >> 16, y >> 16);
+	}
+
+	// 3. Blend and convert
+	k = 0;
+#if defined(FELINA_SSE)
+	const __m128 ys4 = _mm_set1_ps(c.ys), yo4 = _mm_set1_ps(c.yo), mid = _mm_set1_ps(128.0f);
+	const __m128 rv = _mm_set1_ps(c.rv), gu = _mm_set1_ps(c.gu), gv = _mm_set1_ps(c.gv), bu = _mm_set1_ps(c.bu);
+	const __m128i alpha = _mm_set1_epi32(255);
+	for (; k + 4 <= n; k += 4) {
+		const __m128i lx = _mm_loadu_si128((const __m128i*)(fx + k)), ly = _mm_loadu_si128((const __m128i*)(fy + k));
+		const __m128i kx = _mm_loadu_si128((const __m128i*)(cx + k)), ky = _mm_loadu_si128((const __m128i*)(cy + k));
+		const __m128 y = _mm_mul_ps(_mm_sub_ps(QuadLerp4(_mm_loadu_si128((const __m128i*)(qy + k)), lx, ly), yo4), ys4);
+		const __m128 u = _mm_sub_ps(QuadLerp4(_mm_loadu_si128((const __m128i*)(qu + k)), kx, ky), mid);
+		const __m128 v = _mm_sub_ps(QuadLerp4(_mm_loadu_si128((const __m128i*)(qv + k)), kx, ky), mid);
+		const __m128i r = _mm_cvtps_epi32(_mm_add_ps(y, _mm_mul_ps(rv, v)));
+		const __m128i g = _mm_cvtps_epi32(_mm_sub_ps(y, _mm_add_ps(_mm_mul_ps(gu, u), _mm_mul_ps(gv, v))));
+		const __m128i b = _mm_cvtps_epi32(_mm_add_ps(y, _mm_mul_ps(bu, u)));
+
+		// R0..3 B0..3 G0..3 A0..3 (saturated) -> R0 G0 B0 A0 R1 ..
+		const __m128i planar = _mm_packus_epi16(_mm_packs_epi32(r, b), _mm_packs_epi32(g, alpha));
+		const __m128i rgba = _mm_unpacklo_epi8(planar, _mm_srli_si128(planar, 8));
+		_mm_storeu_si128((__m128i*)(out + k * 4), _mm_unpacklo_epi16(rgba, _mm_srli_si128(rgba, 8)));
+	}
+#elif defined(FELINA_NEON)
+	for (; k + 4 <= n; k += 4) {
+		const int32x4_t lx = vld1q_s32(fx + k), ly = vld1q_s32(fy + k);
+		const int32x4_t kx = vld1q_s32(cx + k), ky = vld1q_s32(cy + k);
+		const float32x4_t y = vmulq_n_f32(vsubq_f32(QuadLerp4(vld1q_u32(qy + k), lx, ly), vdupq_n_f32(c.yo)), c.ys);
+		const float32x4_t u = vsubq_f32(QuadLerp4(vld1q_u32(qu + k), kx, ky), vdupq_n_f32(128.0f));
+		const float32x4_t v = vsubq_f32(QuadLerp4(vld1q_u32(qv + k), kx, ky), vdupq_n_f32(128.0f));
+		const uint16x4_t r = vqmovun_s32(vcvtnq_s32_f32(vmlaq_n_f32(y, v, c.rv)));
+		const uint16x4_t g = vqmovun_s32(vcvtnq_s32_f32(vmlsq_n_f32(vmlsq_n_f32(y, u, c.gu), v, c.gv)));
+		const uint16x4_t b = vqmovun_s32(vcvtnq_s32_f32(vmlaq_n_f32(y, u, c.bu)));
+
+		// R0..3 G0..3 | B0..3 A0..3 -> R0 G0 B0 A0 R1 ..
+		const uint8x8_t rg = vqmovn_u16(vcombine_u16(r, g)), ba = vqmovn_u16(vcombine_u16(b, vdup_n_u16(255)));
+		const uint8x8_t rgPairs = vzip_u8(rg, vext_u8(rg, rg, 4)).val[0];  // R0 G0 R1 G1 ..
+		const uint8x8_t baPairs = vzip_u8(ba, vext_u8(ba, ba, 4)).val[0];  // B0 A0 B1 A1 ..
+		const uint16x4x2_t rgba = vzip_u16(vreinterpret_u16_u8(rgPairs), vreinterpret_u16_u8(baPairs));
+		vst1q_u8(out + k * 4, vreinterpretq_u8_u16(vcombine_u16(rgba.val[0], rgba.val[1])));
+	}
+#endif
+
+	for (; k < n; k++) {
+		const float y = (QuadLerp(qy[k], fx[k], fy[k]) - c.yo) * c.ys;
+		const float u = QuadLerp(qu[k], cx[k], cy[k]) - 128.0f, v = QuadLerp(qv[k], cx[k], cy[k]) - 128.0f;
+		const float rgb[3] = { y + c.rv * v, y - c.gu * u - c.gv * v, y + c.bu * u };
+		unsigned char* o = out + k * 4;
+		for (int ch = 0; ch < 3; ch++) o[ch] = (unsigned char)(rgb[ch] < 0.0f ? 0.0f : (rgb[ch] > 255.0f ? 255.0f : rgb[ch] + 0.5f));
+		o[3] = 255;
+	}
+
+	// 4. Pixels behind the camera
+	for (k = 0; k < n; k++) if (xs[k] == WARP_BEHIND) memset(out + k * 4, 0, 4);
+}
+
+// --- TILE SCHEDULE ---
+// Row-major bands walk the source along the page's rotation: at 90 degrees every output pixel
+// of a row lands on a different source row (and page). Instead the output is cut into
+// WARP_TILE x WARP_TILE tiles sorted along a Morton (Z) curve of their source-space centres,
+// so consecutive tiles, and each worker's run of WARP_TILE_RUN tiles, read neighbouring
+// texels whatever the rotation. The next tile's source footprint is prefetched meanwhile.
+
+struct WarpTile {
+	int x0, y0, x1, y1;             // Output pixels [x0, x1) x [y0, y1)
+	int sx0, sy0, sx1, sy1;         // Source texel bounds (inclusive; sx1 < sx0 if behind the camera)
+	unsigned int key;               // Morton code of the source-space centre
+};
+
+// Low 16 bits -> even bits
+static inline unsigned int MortonSpread(unsigned int v) {
+	v &= 0xFFFF;
+	v = (v | (v << 8)) & 0x00FF00FFu;
+	v = (v | (v << 4)) & 0x0F0F0F0Fu;
+	v = (v | (v << 2)) & 0x33333333u;
+	v = (v | (v << 1)) & 0x55555555u;
+	return v;
+}
+
+static void BuildTileSchedule(const WarpParams& p, std::vector<WarpTile>& tiles) {
+	const float* g = p.g;
+	const int tilesX = (p.dst.width + WARP_TILE - 1) / WARP_TILE;
+	const int tilesY = (p.dst.height + WARP_TILE - 1) / WARP_TILE;
+	tiles.resize((size_t)tilesX * tilesY);
+
+	for (int ty = 0; ty < tilesY; ty++) {
+		for (int tx = 0; tx < tilesX; tx++) {
+			WarpTile& t = tiles[(size_t)ty * tilesX + tx];
+			t.x0 = tx * WARP_TILE; t.x1 = t.x0 + WARP_TILE < p.dst.width ? t.x0 + WARP_TILE : p.dst.width;
+			t.y0 = ty * WARP_TILE; t.y1 = t.y0 + WARP_TILE < p.dst.height ? t.y0 + WARP_TILE : p.dst.height;
+
+			// 1. Source bounds of the corners (a homography keeps the quad convex while w > 0)
+			float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+			bool valid = true;
+			for (int c = 0; c < 4; c++) {
+				const float x = (float)((c & 1) ? t.x1 - 1 : t.x0), y = (float)((c & 2) ? t.y1 - 1 : t.y0);
+				const float hw = g[6] * x + g[7] * y + g[8];
+				if (hw <= 1e-8f) { valid = false; break; }
+				const float sx = (g[0] * x + g[1] * y + g[2]) / hw, sy = (g[3] * x + g[4] * y + g[5]) / hw;
+				minX = sx < minX ? sx : minX; maxX = sx > maxX ? sx : maxX;
+				minY = sy < minY ? sy : minY; maxY = sy > maxY ? sy : maxY;
+			}
+			if (!valid) { t.sx0 = t.sy0 = 0; t.sx1 = t.sy1 = -1; t.key = 0; continue; }
+
+			// 2. Clamp to the image (+1 texel for the filter), Morton key of 8-texel cells
+			const float w1 = (float)(p.src.width - 1), h1 = (float)(p.src.height - 1);
+			minX = minX < 0.0f ? 0.0f : (minX > w1 ? w1 : minX); maxX = maxX < 0.0f ? 0.0f : (maxX > w1 ? w1 : maxX);
+			minY = minY < 0.0f ? 0.0f : (minY > h1 ? h1 : minY); maxY = maxY < 0.0f ? 0.0f : (maxY > h1 ? h1 : maxY);
+			t.sx0 = (int)minX; t.sy0 = (int)minY;
+			t.sx1 = (int)maxX + 1 < p.src.width ? (int)maxX + 1 : p.src.width - 1;
+			t.sy1 = (int)maxY + 1 < p.src.height ? (int)maxY + 1 : p.src.height - 1;
+			const unsigned int cx = (unsigned int)(minX + maxX) >> 4, cy = (unsigned int)(minY + maxY) >> 4;
+			t.key = MortonSpread(cx) | (MortonSpread(cy) << 1);
+		}
+	}
+
+	std::sort(tiles.begin(), tiles.end(), [](const WarpTile& a, const WarpTile& b) { return a.key < b.key; });
+}
+
+// Hint a tile's source footprint into cache; skipped when it would not fit L1 anyway
+static inline void PrefetchTile(const WarpImageDesc& src, int texelBytes, const WarpTile& t) {
+	if (t.sx1 < t.sx0 || (t.sx1 - t.sx0 + 1) * (t.sy1 - t.sy0 + 1) * texelBytes > 16 * 1024) return;
+	for (int y = t.sy0; y <= t.sy1; y++) {
+		const unsigned char* row = src.pixels + (size_t)y * src.stride;
+		for (int x = t.sx0 * texelBytes; x < (t.sx1 + 1) * texelBytes; x += 64) FELINA_PREFETCH(row + x);
+		FELINA_PREFETCH(row + (t.sx1 + 1) * texelBytes - 1);
+	}
+}
+
+// Warp one output tile with the given sampler
+template <typename Sampler>
+static void WarpTileRows(const WarpParams& p, const WarpTile& t) {
+	const float minC = Sampler::MinCoord();
+	const float maxX = Sampler::MaxCoord(p.src.width), maxY = Sampler::MaxCoord(p.src.height);
+	const int w = t.x1 - t.x0;
+	float xs[WARP_TILE], ys[WARP_TILE];
+
+	for (int y = t.y0; y < t.y1; y++) {
+		WarpRowCoords(p, t.x0, y, w, minC, maxX, maxY, xs, ys);
+		unsigned char* out = p.dst.pixels + (size_t)y * p.dst.stride + t.x0 * 4;
+		Sampler::SampleRow(p.src, xs, ys, w, out);
+		if (p.composite) CompositeRow(*p.composite, t.x0, y, w, out);
+	}
+}
+
+// Warp one output tile of ARGBHalf with the given half sampler
+template <typename Sampler>
+static void WarpTileRowsHalf(const WarpParams& p, const WarpTile& t) {
+	const float minC = Sampler::MinCoord();
+	const float maxX = Sampler::MaxCoord(p.src.width), maxY = Sampler::MaxCoord(p.src.height);
+	const int w = t.x1 - t.x0;
+	float xs[WARP_TILE], ys[WARP_TILE], row[WARP_TILE * 4];
+
+	for (int y = t.y0; y < t.y1; y++) {
+		WarpRowCoords(p, t.x0, y, w, minC, maxX, maxY, xs, ys);
+		Sampler::SampleRow(p.src, xs, ys, w, row);
+		if (p.composite) CompositeRowFloat(*p.composite, t.x0, y, w, row);
+		FloatToHalfRow(row, (unsigned short*)(p.dst.pixels + (size_t)y * p.dst.stride + t.x0 * HALF_TEXEL_BYTES), w * 4);
+	}
+}
+
+// Warp one output tile from YUV planes
+static void WarpTileRowsYuv(const WarpParams& p, const WarpTile& t) {
+	const float maxX = (float)(p.src.width - 1), maxY = (float)(p.src.height - 1);
+	const int w = t.x1 - t.x0;
+	float xs[WARP_TILE], ys[WARP_TILE];
+
+	for (int y = t.y0; y < t.y1; y++) {
+		WarpRowCoords(p, t.x0, y, w, 0.0f, maxX, maxY, xs, ys);
+		unsigned char* out = p.dst.pixels + (size_t)y * p.dst.stride + t.x0 * 4;
+		SampleRowYuv(p.src, *p.yuv, xs, ys, w, out);
+		if (p.composite) CompositeRow(*p.composite, t.x0, y, w, out);
+	}
+}
+
+// --- REGION OF INTEREST ---
+// Source texels a warp can read. While w > 0 at the output corners the homography maps the
+// output rectangle to a convex quad, so the corners' bounding box holds every sample position;
+// the samplers clamp into the image, which maps that box into the image as well. A filter margin
+// and alignment then widen it. A page crossing the horizon needs the whole image.
+
+struct WarpRoi {
+	int x0, y0, x1, y1;             // Source texels [x0, x1) x [y0, y1)
+};
+
+// align: power of two the corners are rounded outwards to (before clamping to the image)
+static void ComputeSourceRoi(const WarpParams& p, int margin, int align, WarpRoi& roi) {
+	const float* g = p.g;
+	const float cx[4] = { 0.0f, (float)(p.dst.width - 1), 0.0f, (float)(p.dst.width - 1) };
+	const float cy[4] = { 0.0f, 0.0f, (float)(p.dst.height - 1), (float)(p.dst.height - 1) };
+	float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+	for (int i = 0; i < 4; i++) {
+		const float hw = g[6] * cx[i] + g[7] * cy[i] + g[8];
+		if (hw <= 1e-8f) { roi.x0 = roi.y0 = 0; roi.x1 = p.src.width; roi.y1 = p.src.height; return; }
+		const float sx = (g[0] * cx[i] + g[1] * cy[i] + g[2]) / hw, sy = (g[3] * cx[i] + g[4] * cy[i] + g[5]) / hw;
+		minX = sx < minX ? sx : minX; maxX = sx > maxX ? sx : maxX;
+		minY = sy < minY ? sy : minY; maxY = sy > maxY ? sy : maxY;
+	}
+
+	// 1. Clamp into the image like the samplers, widen by the filter
+	const float w1 = (float)(p.src.width - 1), h1 = (float)(p.src.height - 1);
+	minX = minX < 0.0f ? 0.0f : (minX > w1 ? w1 : minX); maxX = maxX < 0.0f ? 0.0f : (maxX > w1 ? w1 : maxX);
+	minY = minY < 0.0f ? 0.0f : (minY > h1 ? h1 : minY); maxY = maxY < 0.0f ? 0.0f : (maxY > h1 ? h1 : maxY);
+	int x0 = (int)minX - margin, y0 = (int)minY - margin;
+	int x1 = (int)maxX + 1 + margin, y1 = (int)maxY + 1 + margin;
+
+	// 2. Align outwards, clamp to the image
+	x0 = x0 < 0 ? 0 : x0 & ~(align - 1);
+	y0 = y0 < 0 ? 0 : y0 & ~(align - 1);
+	x1 = (x1 + align - 1) & ~(align - 1);
+	y1 = (y1 + align - 1) & ~(align - 1);
+	roi.x0 = x0; roi.y0 = y0;
+	roi.x1 = x1 < p.src.width ? x1 : p.src.width;
+	roi.y1 = y1 < p.src.height ? y1 : p.src.height;
+}
+
+// --- ANISOTROPIC DOWNSAMPLING ---
+// High-res feeds shrink a lot, and at grazing angles far more along one axis than the other.
+// An output pixel covers the parallelogram spanned by the columns of the homography's Jacobian.
+// As in GPU anisotropic filtering, its minor axis picks the pyramid level (trilinear) and up to
+// WARP_MAX_ANISOTROPY probes spread along the major axis approximate the area average, so thin
+// lines neither alias nor blur across the page, at <= 2 * WARP_MAX_ANISOTROPY bilinear fetches.
+
+static const int WARP_MAX_LEVELS = 8;
+static const int WARP_MAX_ANISOTROPY = 8;
+
+struct WarpPyramid {
+	WarpImageDesc levels[WARP_MAX_LEVELS];  // Level 0 is the source itself
+	int count;
+	std::unique_ptr<unsigned char[]> storage; // Uninitialised: every texel is written
+};
+
+struct WarpFootprint {
+	float u, v;                     // Centre (level-0 texel coordinates)
+	float majorX, majorY;           // Major axis over one output pixel
+	float lod;                      // Level of detail from the minor axis (may exceed the pyramid)
+	int probes;
+};
+
+// Footprint of output pixel (x, y); false if it is behind the camera
+static inline bool ComputeFootprint(const float* g, float x, float y, WarpFootprint& f) {
+	const float hw = g[6] * x + g[7] * y + g[8];
+	if (hw <= 1e-8f) return false;
+	const float inv = 1.0f / hw;
+	f.u = (g[0] * x + g[1] * y + g[2]) * inv;
+	f.v = (g[3] * x + g[4] * y + g[5]) * inv;
+
+	// Jacobian columns d(u, v)/dx and d(u, v)/dy
+	const float dux = (g[0] - f.u * g[6]) * inv, dvx = (g[3] - f.v * g[6]) * inv;
+	const float duy = (g[1] - f.u * g[7]) * inv, dvy = (g[4] - f.v * g[7]) * inv;
+	const float lx = dux * dux + dvx * dvx, ly = duy * duy + dvy * dvy;
+
+	// Squared lengths throughout: major axis, parallelogram width across it
+	float major2;
+	if (lx >= ly) { major2 = lx; f.majorX = dux; f.majorY = dvx; }
+	else { major2 = ly; f.majorX = duy; f.majorY = dvy; }
+
+	const float det = dux * dvy - dvx * duy;
+	float minor2 = major2 > 1e-24f ? det * det / major2 : 0.0f;
+	const float floor2 = major2 * (1.0f / (WARP_MAX_ANISOTROPY * WARP_MAX_ANISOTROPY));
+	if (minor2 < floor2) minor2 = floor2; // More probes would be unbounded; blur instead
+
+	// probes = ceil(major / minor), at most WARP_MAX_ANISOTROPY
+	int probes = 1;
+	while (probes < WARP_MAX_ANISOTROPY && probes * probes * minor2 < major2 * 0.998f) probes++;
+	f.probes = probes;
+	f.lod = minor2 > 1.0f ? 0.5f * log2f(minor2) : 0.0f;
+	return true;
+}
+
+// 2x2 box reduction (odd edges repeat the last texel)
+static void DownsampleRGBA8(const WarpImageDesc& s, const WarpImageDesc& d, int x0, int x1, int y0, int y1) {
+	for (int y = y0; y < y1; y++) {
+		const unsigned char* r0 = s.pixels + (size_t)(2 * y) * s.stride;
+		const unsigned char* r1 = 2 * y + 1 < s.height ? r0 + s.stride : r0;
+		unsigned char* o = d.pixels + (size_t)y * d.stride;
+		int x = x0;
+
+#if defined(FELINA_SSE)
+		// 2 output texels from 4 source texels of each row
+		const __m128i z = _mm_setzero_si128(), two = _mm_set1_epi16(2);
+		for (; 2 * x + 3 < s.width && x + 1 < x1; x += 2) {
+			const __m128i a = _mm_loadu_si128((const __m128i*)(r0 + 8 * x));
+			const __m128i b = _mm_loadu_si128((const __m128i*)(r1 + 8 * x));
+			const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, z), _mm_unpacklo_epi8(b, z));
+			const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, z), _mm_unpackhi_epi8(b, z));
+			const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+			const __m128i v = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+			_mm_storel_epi64((__m128i*)(o + x * 4), _mm_packus_epi16(v, v));
+		}
+#elif defined(FELINA_NEON)
+		for (; 2 * x + 3 < s.width && x + 1 < x1; x += 2) {
+			const uint8x16_t a = vld1q_u8(r0 + 8 * x), b = vld1q_u8(r1 + 8 * x);
+			const uint16x8_t lo = vaddl_u8(vget_low_u8(a), vget_low_u8(b));
+			const uint16x8_t hi = vaddl_u8(vget_high_u8(a), vget_high_u8(b));
+			const uint16x8_t sum = vcombine_u16(vadd_u16(vget_low_u16(lo), vget_high_u16(lo)),
+				vadd_u16(vget_low_u16(hi), vget_high_u16(hi)));
+			vst1_u8(o + x * 4, vrshrn_n_u16(sum, 2));
+		}
+#endif
+
+		for (; x < x1; x++) {
+			const int a = 8 * x, b = 2 * x + 1 < s.width ? a + 4 : a;
+			for (int c = 0; c < 4; c++) {
+				o[x * 4 + c] = (unsigned char)((r0[a + c] + r0[b + c] + r1[a + c] + r1[b + c] + 2) >> 2);
+			}
+		}
+	}
+}
+
+// Widest footprint over the output. The Jacobian scales with 1 / w and w is affine over the
+// output, so the extremes sit at the output corners.
+static void WidestFootprint(const WarpParams& p, float& maxLod, float& maxMajor) {
+	const float cx[4] = { 0.0f, (float)(p.dst.width - 1), 0.0f, (float)(p.dst.width - 1) };
+	const float cy[4] = { 0.0f, 0.0f, (float)(p.dst.height - 1), (float)(p.dst.height - 1) };
+	maxLod = 0.0f; maxMajor = 0.0f;
+	for (int i = 0; i < 4; i++) {
+		WarpFootprint f;
+		if (!ComputeFootprint(p.g, cx[i], cy[i], f)) continue;
+		const float major = sqrtf(f.majorX * f.majorX + f.majorY * f.majorY);
+		if (f.lod > maxLod) maxLod = f.lod;
+		if (major > maxMajor) maxMajor = major;
+	}
+}
+
+// Level-0 texels beyond a sample position that a footprint reaching 'top' can read: half the
+// major axis, plus the bilinear 2x2 of the coarsest level
+static int AnisotropicMargin(float maxMajor, int top) {
+	return (int)ceilf(0.5f * maxMajor) + (2 << top);
+}
+
+// Pyramid deep enough for the widest footprint, reduced only over the source ROI
+static void BuildWarpPyramid(const WarpParams& p, WarpPyramid& pyr) {
+	float maxLod, maxMajor;
+	WidestFootprint(p, maxLod, maxMajor);
+
+	// 1. Level sizes (each level keeps at least 2x2 texels for the bilinear fetch)
+	int want = (int)ceilf(maxLod) + 1;
+	if (want > WARP_MAX_LEVELS) want = WARP_MAX_LEVELS;
+	pyr.levels[0] = p.src;
+	pyr.count = 1;
+	size_t total = 0;
+	for (int w = p.src.width / 2, h = p.src.height / 2; pyr.count < want && w >= 2 && h >= 2; w /= 2, h /= 2) {
+		WarpImageDesc& d = pyr.levels[pyr.count++];
+		d.width = w; d.height = h; d.stride = w * 4;
+		total += (size_t)d.stride * h;
+	}
+	if (pyr.count == 1) return;
+
+	// 2. ROI aligned to the coarsest level, so each level's ROI is exactly half the one below
+	const int top = pyr.count - 1;
+	WarpRoi roi;
+	ComputeSourceRoi(p, AnisotropicMargin(maxMajor, top), 1 << top, roi);
+
+	// 3. Reduce level by level, rows in parallel (texels outside the ROI stay unwritten and unread)
+	pyr.storage.reset(new unsigned char[total]);
+	size_t offset = 0;
+	for (int l = 1; l < pyr.count; l++) {
+		const WarpImageDesc& s = pyr.levels[l - 1];
+		WarpImageDesc& d = pyr.levels[l];
+		d.pixels = pyr.storage.get() + offset;
+		offset += (size_t)d.stride * d.height;
+
+		const int x0 = roi.x0 >> l, y0 = roi.y0 >> l;
+		const int x1 = ((roi.x1 - 1) >> l) + 1 < d.width ? ((roi.x1 - 1) >> l) + 1 : d.width;
+		const int y1 = ((roi.y1 - 1) >> l) + 1 < d.height ? ((roi.y1 - 1) >> l) + 1 : d.height;
+		const int bands = (y1 - y0 + WARP_BAND_ROWS - 1) / WARP_BAND_ROWS;
+		ParallelFor(bands, [&s, &d, x0, x1, y0, y1](int band) {
+			const int b0 = y0 + band * WARP_BAND_ROWS;
+			DownsampleRGBA8(s, d, x0, x1, b0, b0 + WARP_BAND_ROWS < y1 ? b0 + WARP_BAND_ROWS : y1);
+		});
+	}
+}
+
+// Bilinear fetch of level-0 texel coordinates (x, y) from a pyramid level, weighted into acc
+static inline void AccumulateLevel(const WarpImageDesc& level, float scale, float x, float y, float weight, float* acc) {
+	x = (x + 0.5f) * scale - 0.5f;
+	y = (y + 0.5f) * scale - 0.5f;
+	const float maxX = (float)(level.width - 1), maxY = (float)(level.height - 1);
+	x = x < 0.0f ? 0.0f : (x > maxX ? maxX : x);
+	y = y < 0.0f ? 0.0f : (y > maxY ? maxY : y);
+
+#if defined(FELINA_SSE) || defined(FELINA_NEON)
+	V4Store(acc, V4Add(V4Load(acc), V4Mul(BilinearTexel(level, x, y), V4Set(weight))));
+#else
+	unsigned char texel[4];
+	BilinearRGBA8(level, x, y, texel);
+	for (int c = 0; c < 4; c++) acc[c] += weight * texel[c];
+#endif
+}
+
+// Anisotropic warp of one output tile
+static void WarpTileAnisotropic(const WarpParams& p, const WarpPyramid& pyr, const WarpTile& t) {
+	const int top = pyr.count - 1;
+	float scale[WARP_MAX_LEVELS];
+	for (int l = 0; l < pyr.count; l++) scale[l] = 1.0f / (float)(1 << l);
+
+	for (int y = t.y0; y < t.y1; y++) {
+		unsigned char* out = p.dst.pixels + (size_t)y * p.dst.stride;
+		for (int x = t.x0; x < t.x1; x++) {
+			unsigned char* o = out + x * 4;
+			WarpFootprint f;
+			if (!ComputeFootprint(p.g, (float)x, (float)y, f)) { memset(o, 0, 4); continue; } // behind the camera
+
+			// 1. Two nearest levels
+			float lod = f.lod < (float)top ? f.lod : (float)top;
+			const int l0 = (int)lod;
+			const int l1 = l0 < top ? l0 + 1 : l0;
+			const float fl = lod - l0;
+
+			// 2. Probes at the centres of N equal segments of the major axis
+			float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			const float step = 1.0f / f.probes;
+			for (int i = 0; i < f.probes; i++) {
+				const float k = (i + 0.5f) * step - 0.5f;
+				const float px = f.u + f.majorX * k, py = f.v + f.majorY * k;
+				AccumulateLevel(pyr.levels[l0], scale[l0], px, py, (1.0f - fl) * step, acc);
+				if (fl > 0.0f) AccumulateLevel(pyr.levels[l1], scale[l1], px, py, fl * step, acc);
+			}
+
+			for (int c = 0; c < 4; c++) {
+				const float v = acc[c] + 0.5f;
+				o[c] = (unsigned char)(v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v));
+			}
+		}
+		if (p.composite) CompositeRow(*p.composite, t.x0, y, t.x1 - t.x0, out + t.x0 * 4);
+	}
+}
+
+// WarpImage filters
+enum {
+	WARP_FILTER_BILINEAR = 0,       // tex2D
+	WARP_FILTER_BICUBIC = 1,        // Catmull-Rom, as unwarp.shader's tex2D_bicubic
+	WARP_FILTER_BILINEAR_FIXED = 2, // 16.16 coordinates, 8-bit weights (RGBA8 integer path)
+	WARP_FILTER_ANISOTROPIC = 3     // Footprint-filtered over a box pyramid, for strong minification
+};
+
+// WarpImageYuv colour spaces
+enum {
+	YUV_BT601_FULL = 0,             // JPEG / full range (ARKit and ARCore camera images)
+	YUV_BT601_VIDEO = 1,            // Studio swing (16..235)
+	YUV_BT709_VIDEO = 2
+};
+
+// Y scale, Y offset, R from V, G from U, G from V, B from U
+static const float YUV_MATRICES[3][6] = {
+	{ 1.0f, 0.0f, 1.402f, 0.344136f, 0.714136f, 1.772f },
+	{ 1.164384f, 16.0f, 1.596027f, 0.391762f, 0.812968f, 2.017232f },
+	{ 1.164384f, 16.0f, 1.792741f, 0.213249f, 0.532909f, 2.112402f }
+};
+
+// Texels a filter reads beyond its sample positions
+static int FilterMargin(const WarpParams& p, int filter) {
+	if (filter == WARP_FILTER_BICUBIC) return 2;   // 4x4 around floor(x)
+	if (filter != WARP_FILTER_ANISOTROPIC) return 1;
+
+	float maxLod, maxMajor;
+	WidestFootprint(p, maxLod, maxMajor);
+	int top = (int)ceilf(maxLod);
+	if (top > WARP_MAX_LEVELS - 1) top = WARP_MAX_LEVELS - 1;
+	return AnisotropicMargin(maxMajor, top);
+}
+
+// Schedule and run the tiles of a prepared warp
+static bool RunWarp(const WarpParams& p, int filter) {
+	WarpPyramid pyr;
+	if (filter == WARP_FILTER_ANISOTROPIC) BuildWarpPyramid(p, pyr);
+
+	std::vector<WarpTile> tiles;
+	BuildTileSchedule(p, tiles);
+	const int count = (int)tiles.size();
+	const int runs = (count + WARP_TILE_RUN - 1) / WARP_TILE_RUN;
+
+	ParallelFor(runs, [&p, &pyr, &tiles, count, filter](int run) {
+		const int i0 = run * WARP_TILE_RUN;
+		const int i1 = i0 + WARP_TILE_RUN < count ? i0 + WARP_TILE_RUN : count;
+		for (int i = i0; i < i1; i++) {
+			const WarpTile& t = tiles[i];
+			if (filter == WARP_FILTER_ANISOTROPIC) { WarpTileAnisotropic(p, pyr, t); continue; } // reads the pyramid
+
+			if (i + 1 < i1) PrefetchTile(p.src, p.yuv ? 1 : (p.half ? HALF_TEXEL_BYTES : 4), tiles[i + 1]);
+			if (p.yuv) WarpTileRowsYuv(p, t);
+			else if (p.half) {
+				if (filter == WARP_FILTER_BICUBIC) WarpTileRowsHalf<BicubicHalfSampler>(p, t);
+				else WarpTileRowsHalf<BilinearHalfSampler>(p, t);
+			}
+			else if (filter == WARP_FILTER_BICUBIC) WarpTileRows<BicubicSampler>(p, t);
+			else if (filter == WARP_FILTER_BILINEAR_FIXED) WarpTileRows<BilinearFixedSampler>(p, t);
+			else WarpTileRows<BilinearSampler>(p, t);
+		}
+	});
+	return true;
+}
+
+// Argument checks and setup shared by the warp exports
+static bool InitWarpParams(WarpParams& p, unsigned char* src, int srcW, int srcH, int srcStride,
+	unsigned char* dst, int dstW, int dstH, int dstStride,
+	const Float4x4* unwarp, const Float4x4* display, float maxError, bool half) {
+	if (!src || !dst || !unwarp || srcW < 2 || srcH < 2 || dstW < 1 || dstH < 1) return false;
+
+	const int texelBytes = half ? HALF_TEXEL_BYTES : 4;
+	p.src.pixels = src; p.src.width = srcW; p.src.height = srcH;
+	p.src.stride = srcStride > 0 ? srcStride : srcW * texelBytes;
+	p.dst.pixels = dst; p.dst.width = dstW; p.dst.height = dstH;
+	p.dst.stride = dstStride > 0 ? dstStride : dstW * texelBytes;
+	p.maxError = maxError > 0.0f ? maxError : 0.0f;
+	p.composite = NULL;
+	p.half = half;
+	p.yuv = NULL;
+	return BuildWarpMatrix(unwarp, display, srcW, srcH, dstW, dstH, p.g);
+}
+
+static bool InitCompositeParams(CompositeParams& c, unsigned char* ref, int refW, int refH, int refStride,
+	int dstW, int dstH, float whitePoint) {
+	if (!ref || refW < 2 || refH < 2 || !(whitePoint > 0.1f)) return false;
+
+	c.ref.pixels = ref; c.ref.width = refW; c.ref.height = refH;
+	c.ref.stride = refStride > 0 ? refStride : refW * 4;
+	c.refMatchesDst = refW == dstW && refH == dstH;
+	c.refScaleX = (float)refW / dstW;
+	c.refScaleY = (float)refH / dstH;
+	c.whitePoint = whitePoint;
+	BuildWhiteCurve(whitePoint, c.curve);
+	return true;
+}
+
+extern "C" {
+
+	// --- STEP 12: CPU UNWARP ---
+	// src: camera image, dst: unwarped output; both 8-bit RGBA in Unity row order
+	// (row 0 = v 0), strides in bytes (0 = tightly packed).
+	// unwarp: _Unwarp (output UV -> normalised screen), display: _DisplayMatrix (optional).
+	// filter: WARP_FILTER_BILINEAR, WARP_FILTER_BICUBIC, WARP_FILTER_BILINEAR_FIXED or
+	// WARP_FILTER_ANISOTROPIC (builds a pyramid of src; always computes footprints exactly).
+	// maxError: tolerated coordinate error in source texels; > 0 replaces the per-pixel divide
+	// with piecewise-affine scanline spans (e.g. 0.05), 0 divides exactly per pixel.
+	// Texture coordinates are clamped like the shader's saturate(); texels whose homogeneous
+	// w is not positive are written as transparent black.
+	EXPORT_API bool WarpImage(
+		unsigned char* src, int srcW, int srcH, int srcStride,
+		unsigned char* dst, int dstW, int dstH, int dstStride,
+		Float4x4* unwarp,
+		Float4x4* display,
+		int filter,
+		float maxError
+	) {
+		WarpParams p;
+		if (!InitWarpParams(p, src, srcW, srcH, srcStride, dst, dstW, dstH, dstStride, unwarp, display, maxError, false)) return false;
+		return RunWarp(p, filter);
+	}
+
+	// --- STEP 13: FUSED UNWARP + COMPOSITE ---
+	// WarpImage followed by ARColoringComposite in one pass over memory:
+	// dst = float4(smoothstep(0.1, whitePoint, col.rgb), col.a) * ref.
+	// ref: reference texture (_RefTex), 8-bit RGBA in Unity row order; streamed row for row
+	// when it has the output's size, otherwise resampled bilinearly at the output UV.
+	// whitePoint: _WhitePoint, must be > 0.1.
+	EXPORT_API bool WarpComposite(
+		unsigned char* src, int srcW, int srcH, int srcStride,
+		unsigned char* ref, int refW, int refH, int refStride,
+		unsigned char* dst, int dstW, int dstH, int dstStride,
+		Float4x4* unwarp,
+		Float4x4* display,
+		int filter,
+		float maxError,
+		float whitePoint
+	) {
+		WarpParams p;
+		CompositeParams c;
+		if (!InitWarpParams(p, src, srcW, srcH, srcStride, dst, dstW, dstH, dstStride, unwarp, display, maxError, false)) return false;
+		if (!InitCompositeParams(c, ref, refW, refH, refStride, dstW, dstH, whitePoint)) return false;
+
+		// Warp, compositing each tile row as it is written
+		p.composite = &c;
+		return RunWarp(p, filter);
+	}
+
+	// --- STEP 14: HALF-FLOAT UNWARP ---
+	// WarpImage and WarpComposite on ARGBHalf buffers (4 x binary16 per texel, strides in
+	// bytes, 0 = tightly packed); the reference stays 8-bit RGBA. Only WARP_FILTER_BILINEAR
+	// and WARP_FILTER_BICUBIC apply, other filters fail. Output is not clamped to [0, 1].
+	EXPORT_API bool WarpImageHalf(
+		unsigned short* src, int srcW, int srcH, int srcStride,
+		unsigned short* dst, int dstW, int dstH, int dstStride,
+		Float4x4* unwarp,
+		Float4x4* display,
+		int filter,
+		float maxError
+	) {
+		if (filter != WARP_FILTER_BILINEAR && filter != WARP_FILTER_BICUBIC) return false;
+
+		WarpParams p;
+		if (!InitWarpParams(p, (unsigned char*)src, srcW, srcH, srcStride, (unsigned char*)dst, dstW, dstH, dstStride,
+			unwarp, display, maxError, true)) return false;
+		return RunWarp(p, filter);
+	}
+
+	EXPORT_API bool WarpCompositeHalf(
+		unsigned short* src, int srcW, int srcH, int srcStride,
+		unsigned char* ref, int refW, int refH, int refStride,
+		unsigned short* dst, int dstW, int dstH, int dstStride,
+		Float4x4* unwarp,
+		Float4x4* display,
+		int filter,
+		float maxError,
+		float whitePoint
+	) {
+		if (filter != WARP_FILTER_BILINEAR && filter != WARP_FILTER_BICUBIC) return false;
+
+		WarpParams p;
+		CompositeParams c;
+		if (!InitWarpParams(p, (unsigned char*)src, srcW, srcH, srcStride, (unsigned char*)dst, dstW, dstH, dstStride,
+			unwarp, display, maxError, true)) return false;
+		if (!InitCompositeParams(c, ref, refW, refH, refStride, dstW, dstH, whitePoint)) return false;
+
+		p.composite = &c;
+		return RunWarp(p, filter);
+	}
+
+	// --- STEP 16: YUV 4:2:0 UNWARP ---
+	// WarpImage (bilinear) straight from the camera planes to 8-bit RGBA, alpha 255.
+	// yPlane: srcW x srcH luma, yStride bytes per row (0 = srcW).
+	// uPlane, vPlane: (srcW + 1) / 2 x (srcH + 1) / 2 chroma, uvStride bytes per row and
+	// uvPixelStride bytes per texel (YUV_420_888 / XRCpuImage plane layout):
+	// NV12: u = uv, v = uv + 1, pixel stride 2; NV21: v = vu, u = vu + 1, 2; I420: 1.
+	// colorSpace: YUV_BT601_FULL, YUV_BT601_VIDEO or YUV_BT709_VIDEO.
+	EXPORT_API bool WarpImageYuv(
+		unsigned char* yPlane, int srcW, int srcH, int yStride,
+		unsigned char* uPlane, unsigned char* vPlane, int uvStride, int uvPixelStride,
+		int colorSpace,
+		unsigned char* dst, int dstW, int dstH, int dstStride,
+		Float4x4* unwarp,
+		Float4x4* display,
+		float maxError
+	) {
+		if (!uPlane || !vPlane || uvPixelStride < 1 || colorSpace < YUV_BT601_FULL || colorSpace > YUV_BT709_VIDEO) return false;
+
+		// 1. Luma as the warp source, chroma alongside
+		WarpParams p;
+		if (!InitWarpParams(p, yPlane, srcW, srcH, yStride > 0 ? yStride : srcW, dst, dstW, dstH, dstStride,
+			unwarp, display, maxError, false)) return false;
+
+		YuvPlanes c;
+		c.u = uPlane; c.v = vPlane;
+		c.width = (srcW + 1) / 2; c.height = (srcH + 1) / 2;
+		if (c.width < 2 || c.height < 2) return false;
+		c.pixelStride = uvPixelStride;
+		c.rowStride = uvStride > 0 ? uvStride : c.width * uvPixelStride;
+
+		// 2. Conversion matrix
+		const float* m = YUV_MATRICES[colorSpace];
+		c.ys = m[0]; c.yo = m[1];
+		c.rv = m[2]; c.gu = m[3]; c.gv = m[4]; c.bu = m[5];
+
+		p.yuv = &c;
+		return RunWarp(p, WARP_FILTER_BILINEAR_FIXED);
+	}
+
+	// --- STEP 17: SOURCE REGION OF INTEREST ---
+	// Source texels a warp with these arguments reads (as WarpImage, without the buffers), so
+	// copies, conversions and analysis upstream can be limited to them.
+	// yuv420: non-zero for WarpImageYuv sources; widens the margin to the chroma footprint and
+	// aligns the rectangle to even texels so it halves exactly into the chroma planes.
+	// roi: x, y, width, height in source texels; the whole image when the page crosses the horizon.
+	EXPORT_API bool ComputeWarpRoi(
+		int srcW, int srcH,
+		int dstW, int dstH,
+		Float4x4* unwarp,
+		Float4x4* display,
+		int filter,
+		int yuv420,
+		int* roi
+	) {
+		if (!unwarp || !roi || srcW < 2 || srcH < 2 || dstW < 1 || dstH < 1) return false;
+
+		WarpParams p;
+		p.src.width = srcW; p.src.height = srcH;
+		p.dst.width = dstW; p.dst.height = dstH;
+		if (!BuildWarpMatrix(unwarp, display, srcW, srcH, dstW, dstH, p.g)) return false;
+
+		// Chroma at x / 2 - 0.25 reaches 2.5 luma texels around x
+		WarpRoi r;
+		if (yuv420) ComputeSourceRoi(p, 3, 2, r);
+		else ComputeSourceRoi(p, FilterMargin(p, filter), 1, r);
+		roi[0] = r.x0; roi[1] = r.y0;
+		roi[2] = r.x1 - r.x0; roi[3] = r.y1 - r.y0;
+		return true;
+	}
+}
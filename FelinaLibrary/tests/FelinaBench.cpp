@@ -0,0 +1,215 @@
+// Felina native benchmarks
+// Times the exported kernels of the plugin on synthetic camera frames. Each figure is the
+// fastest of several runs (milliseconds per call), which is the most stable statistic on a
+// loaded machine. Build with CMAKE_BUILD_TYPE=Release and run without arguments.
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "FelinaCommon.h"
+
+extern "C" {
+	void* CreateHomographyEstimator(int maxPoints);
+	void DestroyHomographyEstimator(void* estimator);
+	bool EstimateHomographyRobust(void* estimator, Float2* srcPoints, Float2* dstPoints, float* scores, int count,
+		float threshold, float confidence, int maxIterations, float budgetMs, Float4x4* result,
+		unsigned char* inlierMask, RobustFit* fit);
+	void ComputeTransformMatrix(float screenW, float screenH, Float2* rawScreenPoints, Float4x4* result);
+	bool WarpImage(unsigned char* src, int srcW, int srcH, int srcStride, unsigned char* dst, int dstW, int dstH, int dstStride,
+		Float4x4* unwarp, Float4x4* display, int filter, float maxError);
+}
+
+// --- HELPERS ---
+
+static const int BENCH_RUNS = 10;
+
+static double NowMs() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Fastest of BENCH_RUNS calls
+template <typename F>
+static double BestOf(F run) {
+	double best = 1e30;
+	for (int r = 0; r < BENCH_RUNS; r++) {
+		const double t0 = NowMs();
+		run();
+		const double t = NowMs() - t0;
+		if (t < best) best = t;
+	}
+	return best;
+}
+
+// Camera-like RGBA8 frame: gradients, a checkerboard and some noise
+static std::vector<unsigned char> MakeFrame(int width, int height) {
+	std::vector<unsigned char> frame((size_t)width * height * 4);
+	unsigned int seed = 7;
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			unsigned char* p = &frame[((size_t)y * width + x) * 4];
+			seed = seed * 1664525u + 1013904223u;
+			p[0] = (unsigned char)((x * 7 + y * 3) ^ (seed >> 28));
+			p[1] = ((x / 8 + y / 8) & 1) ? 230 : 20;
+			p[2] = (unsigned char)(128.0f + 127.0f * sinf(x * 0.05f) * cosf(y * 0.07f));
+			p[3] = 255;
+		}
+	}
+	return frame;
+}
+
+// --- BENCHMARKS ---
+
+// WARP_FILTER_BILINEAR_FIXED against the float bilinear path, exact and with spans
+static void BenchFixedWarp() {
+	const int srcW = 1920, srcH = 1440, dstW = 1280, dstH = 720;
+	std::vector<unsigned char> src = MakeFrame(srcW, srcH), dst((size_t)dstW * dstH * 4);
+	Float2 page[4] = { { 300, 200 }, { 1500, 260 }, { 1650, 1300 }, { 200, 1200 } };
+	Float4x4 unwarp;
+	ComputeTransformMatrix((float)srcW, (float)srcH, page, &unwarp);
+
+	printf("Fixed-point warp, %dx%d -> %dx%d (ms)\n", srcW, srcH, dstW, dstH);
+	printf("  %-14s %10s %10s\n", "", "float", "fixed");
+	for (int spans = 0; spans < 2; spans++) {
+		const float maxError = spans ? 0.05f : 0.0f;
+		double t[2];
+		for (int i = 0; i < 2; i++) {
+			const int filter = i ? 2 : 0;
+			t[i] = BestOf([&] { WarpImage(src.data(), srcW, srcH, 0, dst.data(), dstW, dstH, 0, &unwarp, nullptr, filter, maxError); });
+		}
+		printf("  %-14s %10.2f %10.2f\n", spans ? "spans (0.05)" : "exact divide", t[0], t[1]);
+	}
+}
+
+// WARP_FILTER_BICUBIC against bilinear, for the page quad with and without a display rotation
+static void BenchBicubicWarp() {
+	const int srcW = 1920, srcH = 1440, dstW = 1280, dstH = 720;
+	std::vector<unsigned char> src = MakeFrame(srcW, srcH), dst((size_t)dstW * dstH * 4);
+	Float2 page[4] = { { 300, 200 }, { 1500, 260 }, { 1650, 1300 }, { 200, 1200 } };
+	Float4x4 unwarp;
+	ComputeTransformMatrix((float)srcW, (float)srcH, page, &unwarp);
+	Float4x4 rotate = {};
+	rotate.c0y = 1.0f; rotate.c1x = -1.0f; rotate.c2z = 1.0f; rotate.c3x = 1.0f; rotate.c3w = 1.0f;
+
+	printf("Bicubic warp, %dx%d -> %dx%d (ms)\n", srcW, srcH, dstW, dstH);
+	printf("  %-14s %10s %10s\n", "", "bilinear", "bicubic");
+	for (int rotated = 0; rotated < 2; rotated++) {
+		Float4x4* display = rotated ? &rotate : nullptr;
+		double t[2];
+		for (int filter = 0; filter < 2; filter++)
+			t[filter] = BestOf([&] { WarpImage(src.data(), srcW, srcH, 0, dst.data(), dstW, dstH, 0, &unwarp, display, filter, 0.0f); });
+		printf("  %-14s %10.2f %10.2f\n", rotated ? "display rotate" : "page quad", t[0], t[1]);
+	}
+}
+
+// Page rotated in the camera frame from 0 to 90 degrees: the tiled traversal should keep the
+// time per frame flat across angles. Angles and filters are interleaved within each round so
+// that a noisy stretch on a shared host hits every column, not one of them.
+static void BenchRotationSweep() {
+	const int srcW = 3840, srcH = 2880, dstW = 1280, dstH = 720;
+	const int angles = 7, rounds = 3 * BENCH_RUNS;
+	std::vector<unsigned char> src = MakeFrame(srcW, srcH), dst((size_t)dstW * dstH * 4);
+
+	// 1. Page rectangle around the image centre, rotated by 0, 15, ... 90 degrees
+	Float4x4 unwarp[angles];
+	for (int i = 0; i < angles; i++) {
+		const float a = i * 15 * 3.14159265f / 180.0f, c = cosf(a), s = sinf(a);
+		const float hw = srcH * 0.3f, hh = hw * 0.75f, cx = srcW * 0.5f, cy = srcH * 0.5f;
+		const float lx[4] = { -hw, hw, hw, -hw }, ly[4] = { -hh, -hh, hh, hh };
+		Float2 quad[4];
+		for (int k = 0; k < 4; k++) {
+			quad[k].x = cx + c * lx[k] - s * ly[k];
+			quad[k].y = cy + s * lx[k] + c * ly[k];
+		}
+		ComputeTransformMatrix((float)srcW, (float)srcH, quad, &unwarp[i]);
+	}
+
+	// 2. Fastest of the interleaved rounds per angle and filter
+	double best[2][angles];
+	for (int f = 0; f < 2; f++) for (int i = 0; i < angles; i++) best[f][i] = 1e30;
+	for (int r = 0; r < rounds; r++) {
+		for (int i = 0; i < angles; i++) {
+			for (int f = 0; f < 2; f++) {
+				const double t0 = NowMs();
+				WarpImage(src.data(), srcW, srcH, 0, dst.data(), dstW, dstH, 0, &unwarp[i], nullptr, f ? 2 : 0, 0.0f);
+				const double t = NowMs() - t0;
+				if (t < best[f][i]) best[f][i] = t;
+			}
+		}
+	}
+
+	printf("Rotation sweep, %dx%d -> %dx%d (ms, best of %d interleaved rounds)\n", srcW, srcH, dstW, dstH, rounds);
+	printf("  %-10s", "degrees");
+	for (int i = 0; i < angles; i++) printf(" %6d", i * 15);
+	printf("\n");
+	for (int f = 0; f < 2; f++) {
+		printf("  %-10s", f ? "fixed" : "bilinear");
+		for (int i = 0; i < angles; i++) printf(" %6.2f", best[f][i]);
+		printf("\n");
+	}
+}
+
+// PROSAC over tracked points with a share of outliers, inside a 4 ms budget: how many
+// iterations the adaptive termination needed and hypotheses scored per millisecond. Short
+// runs include the final refit in iter/ms; at 80% outliers the budget runs out first.
+static void BenchRobustHomography() {
+	const float budgetMs = 4.0f;
+	const float h[9] = { 0.9f, -0.12f, 140.0f, 0.08f, 1.05f, 60.0f, 4e-5f, -3e-5f, 1.0f };
+
+	printf("Robust homography (PROSAC), %.0f ms budget\n", budgetMs);
+	printf("  %-8s %-9s %11s %8s %8s %9s\n", "points", "outlier%", "iterations", "ms", "iter/ms", "inliers");
+	const int counts[3] = { 64, 256, 1024 };
+	const float outlierRatios[4] = { 0.1f, 0.3f, 0.5f, 0.8f };
+	for (int c = 0; c < 3; c++) {
+		const int count = counts[c];
+		std::vector<Float2> src(count), dst(count);
+		std::vector<unsigned char> mask(count);
+		void* est = CreateHomographyEstimator(count);
+		for (int r = 0; r < 4; r++) {
+			// 1. Inliers: projected through h with 0.5 px of noise; outliers: anywhere in the frame.
+			// Unscored points are taken as sorted best-first, so outliers are spread through the list
+			unsigned int seed = 11 + c * 4 + r;
+			for (int i = 0; i < count; i++) {
+				float v[5];
+				for (int k = 0; k < 5; k++) {
+					seed = seed * 1664525u + 1013904223u;
+					v[k] = (seed >> 8) / 16777216.0f;
+				}
+				src[i].x = v[0] * 1920.0f; src[i].y = v[1] * 1440.0f;
+				if (v[4] < outlierRatios[r]) { dst[i].x = v[2] * 1920.0f; dst[i].y = v[3] * 1440.0f; continue; }
+				const float w = h[6] * src[i].x + h[7] * src[i].y + h[8];
+				dst[i].x = (h[0] * src[i].x + h[1] * src[i].y + h[2]) / w + v[2] - 0.5f;
+				dst[i].y = (h[3] * src[i].x + h[4] * src[i].y + h[5]) / w + v[3] - 0.5f;
+			}
+
+			// 2. Best iter/ms of BENCH_RUNS estimates (the estimator's random state carries over)
+			RobustFit best = {};
+			float bestRate = 0.0f;
+			for (int run = 0; run < BENCH_RUNS; run++) {
+				Float4x4 result;
+				RobustFit fit;
+				EstimateHomographyRobust(est, src.data(), dst.data(), nullptr, count, 3.0f, 0.0f, 100000, budgetMs,
+					&result, mask.data(), &fit);
+				const float rate = fit.elapsedMs > 0.0f ? fit.iterations / fit.elapsedMs : 0.0f;
+				if (rate >= bestRate) { bestRate = rate; best = fit; }
+			}
+			printf("  %-8d %-9.0f %11d %8.3f %8.1f %9d\n", count, outlierRatios[r] * 100.0f, best.iterations, best.elapsedMs,
+				bestRate, best.inlierCount);
+		}
+		DestroyHomographyEstimator(est);
+	}
+}
+
+int main() {
+	printf("Felina benchmarks, %u hardware thread(s)\n\n", std::thread::hardware_concurrency());
+	BenchFixedWarp();
+	printf("\n");
+	BenchBicubicWarp();
+	printf("\n");
+	BenchRotationSweep();
+	printf("\n");
+	BenchRobustHomography();
+	return 0;
+}
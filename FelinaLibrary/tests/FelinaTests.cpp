@@ -0,0 +1,549 @@
+// Felina native tests
+// Regression checks for the exported kernels, run by CTest against the SIMD and the scalar
+// build of the library (see CMakeLists.txt). Each test returns false after printing what
+// went wrong; the process exits non-zero if any failed. Kernels that must be bit-exact
+// across the two builds write their output to the directory given as the first argument,
+// and CTest compares the two directories file by file.
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "FelinaCommon.h"
+
+struct AlignResult;
+
+extern "C" {
+	bool RefineTransformMatrix(void* aligner, unsigned char* image, int width, int height,
+		Float4x4* initial, int maxIterations, Float4x4* result, AlignResult* info);
+	void* CreateHomographyEstimator(int maxPoints);
+	void DestroyHomographyEstimator(void* estimator);
+	bool EstimateHomographyRobust(void* estimator, Float2* srcPoints, Float2* dstPoints, float* scores, int count,
+		float threshold, float confidence, int maxIterations, float budgetMs, Float4x4* result,
+		unsigned char* inlierMask, RobustFit* fit);
+	void ComputeTransformMatrix(float screenW, float screenH, Float2* rawScreenPoints, Float4x4* result);
+	bool WarpImage(unsigned char* src, int srcW, int srcH, int srcStride, unsigned char* dst, int dstW, int dstH, int dstStride,
+		Float4x4* unwarp, Float4x4* display, int filter, float maxError);
+	bool PrepareReference(const char* name, unsigned char* rgba, int width, int height, int stride, float lineThreshold);
+	bool GetReferenceDistanceField(const char* name, unsigned char* lineMask, float* distance, int* width, int* height);
+	int GetReferenceRegionCount(const char* name);
+	bool GetReferenceRegions(const char* name, int* regionMap, int* bounds, int* areas);
+	void ReleaseReference(const char* name);
+	bool BleedUnderOutlines(const char* name, unsigned char* rgba, int width, int height, int stride, float edgeMargin);
+	bool WarpImageYuv(unsigned char* yPlane, int srcW, int srcH, int yStride,
+		unsigned char* uPlane, unsigned char* vPlane, int uvStride, int uvPixelStride, int colorSpace,
+		unsigned char* dst, int dstW, int dstH, int dstStride, Float4x4* unwarp, Float4x4* display, float maxError);
+}
+
+// --- HELPERS ---
+
+static std::string s_outputDir;
+
+// Writes an output that CTest compares between the SIMD and the scalar build
+static bool WriteOutput(const char* name, const std::vector<unsigned char>& data) {
+	const std::string path = s_outputDir + "/" + name;
+	FILE* f = fopen(path.c_str(), "wb");
+	if (!f) {
+		printf("  cannot write %s\n", path.c_str());
+		return false;
+	}
+	const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+	fclose(f);
+	return ok;
+}
+
+// Unwarp matrix from a row-major 3x3 homography (output UV -> normalised source)
+static Float4x4 MatrixFromHomography(const float* h) {
+	Float4x4 m = {};
+	m.c0x = h[0]; m.c1x = h[1]; m.c2x = h[2];
+	m.c0y = h[3]; m.c1y = h[4]; m.c2y = h[5];
+	m.c0z = h[6]; m.c1z = h[7]; m.c2z = h[8];
+	m.c3w = 1.0f;
+	return m;
+}
+
+// Deterministic test pattern
+static void FillPattern(std::vector<unsigned char>& v, unsigned int seed) {
+	for (size_t i = 0; i < v.size(); i++) {
+		seed = seed * 1664525u + 1013904223u;
+		v[i] = (unsigned char)(seed >> 24);
+	}
+}
+
+// Random outline mask: each pixel is outline (1) with the given probability
+static std::vector<unsigned char> RandomOutlines(int width, int height, float density, unsigned int seed) {
+	std::vector<unsigned char> mask((size_t)width * height);
+	for (size_t i = 0; i < mask.size(); i++) {
+		seed = seed * 1664525u + 1013904223u;
+		mask[i] = (seed >> 8) / 16777216.0f < density;
+	}
+	return mask;
+}
+
+// Prepares a reference whose outlines are exactly the given mask (black on white, opaque)
+static bool PrepareOutlines(const char* name, const std::vector<unsigned char>& mask, int width, int height) {
+	std::vector<unsigned char> rgba(mask.size() * 4, 255);
+	for (size_t i = 0; i < mask.size(); i++)
+		if (mask[i]) rgba[i * 4] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = 0;
+	ReleaseReference(name);
+	if (PrepareReference(name, rgba.data(), width, height, 0, 0.0f)) return true;
+	printf("  PrepareReference failed for %dx%d\n", width, height);
+	return false;
+}
+
+// --- TESTS ---
+
+// A warp onto a same-size output through the identity lands every fixed-point sample on a
+// texel centre: the output is the source again, except that the clamp stops the last row and
+// column 1/256 texel short of the edge (two lerps, so 2 levels). A sanity check of both builds.
+static bool TestIdentityWarp() {
+	const int w = 67, h = 45;
+	std::vector<unsigned char> src(w * h * 4), dst(w * h * 4);
+	for (size_t i = 0; i < src.size(); i++) src[i] = (unsigned char)(i * 37 + (i >> 7));
+	Float4x4 identity = {};
+	identity.c0x = 1.0f; identity.c1y = 1.0f; identity.c2z = 1.0f; identity.c3w = 1.0f;
+
+	if (!WarpImage(src.data(), w, h, 0, dst.data(), w, h, 0, &identity, nullptr, 2, 0.0f)) {
+		printf("  WarpImage failed\n");
+		return false;
+	}
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w * 4; x++) {
+			const int i = y * w * 4 + x, diff = dst[i] - src[i];
+			const int tolerance = (y == h - 1 || x >= (w - 1) * 4) ? 2 : 0;
+			if (diff < -tolerance || diff > tolerance) {
+				printf("  pixel (%d, %d): %d instead of %d\n", x / 4, y, dst[i], src[i]);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Rows whose homogeneous w turns negative part-way across, at widths that leave a scalar tail
+// after the 4-wide loops: pixels behind the camera must come out transparent black without
+// their coordinates ever being converted or gathered.
+static bool TestYuvWarpAcrossHorizon() {
+	const int srcW = 64, srcH = 64, cw = srcW / 2, ch = srcH / 2;
+	std::vector<unsigned char> y(srcW * srcH), uv(cw * ch * 2);
+	FillPattern(y, 1);
+	FillPattern(uv, 2);
+
+	// w = 1 - 1.5 u: the right third of every row is behind the camera
+	const float h[9] = { 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, -1.5f, 0.0f, 1.0f };
+	Float4x4 unwarp = MatrixFromHomography(h);
+	for (int dstW = 33; dstW <= 39; dstW++) {
+		const int dstH = 7;
+		std::vector<unsigned char> dst(dstW * dstH * 4, 0x5A);
+		if (!WarpImageYuv(y.data(), srcW, srcH, 0, uv.data(), uv.data() + 1, cw * 2, 2, 0,
+			dst.data(), dstW, dstH, 0, &unwarp, nullptr, 0.0f)) {
+			printf("  WarpImageYuv failed at dstW = %d\n", dstW);
+			return false;
+		}
+		for (int py = 0; py < dstH; py++) {
+			for (int px = 0; px < dstW; px++) {
+				const unsigned char* o = &dst[(py * dstW + px) * 4];
+				const float w = 1.0f - 1.5f * (px + 0.5f) / dstW;
+				const bool behind = w <= 1e-3f, front = w >= 1e-3f;
+				if (behind && (o[0] | o[1] | o[2] | o[3])) {
+					printf("  dstW = %d: pixel (%d, %d) behind the camera is not cleared\n", dstW, px, py);
+					return false;
+				}
+				if (front && o[3] != 255) {
+					printf("  dstW = %d: pixel (%d, %d) in front of the camera is not opaque\n", dstW, px, py);
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+// WARP_FILTER_BILINEAR_FIXED must give the same bytes with and without SIMD (the scalar
+// build is the reference): page quad, display rotation and a quad wider than the image,
+// each with exact divides and with scanline spans. Widths leave scalar tails in every row.
+static bool TestFixedWarpOutput() {
+	const int srcW = 240, srcH = 180, dstW = 157, dstH = 83;
+	std::vector<unsigned char> src(srcW * srcH * 4);
+	FillPattern(src, 3);
+
+	Float2 page[4] = { { 40, 25 }, { 190, 32 }, { 206, 160 }, { 25, 150 } };
+	Float2 wide[4] = { { -25, -12 }, { 262, 0 }, { 237, 187 }, { 0, 200 } };
+	Float4x4 unwarpPage, unwarpWide;
+	ComputeTransformMatrix((float)srcW, (float)srcH, page, &unwarpPage);
+	ComputeTransformMatrix((float)srcW, (float)srcH, wide, &unwarpWide);
+	Float4x4 rotate = {};
+	rotate.c0y = 1.0f; rotate.c1x = -1.0f; rotate.c2z = 1.0f; rotate.c3x = 1.0f; rotate.c3w = 1.0f;
+
+	std::vector<unsigned char> all, dst(dstW * dstH * 4);
+	for (int config = 0; config < 3; config++) {
+		for (int spans = 0; spans < 2; spans++) {
+			Float4x4* unwarp = config == 2 ? &unwarpWide : &unwarpPage;
+			if (!WarpImage(src.data(), srcW, srcH, 0, dst.data(), dstW, dstH, 0, unwarp,
+				config == 1 ? &rotate : nullptr, 2, spans ? 0.05f : 0.0f)) {
+				printf("  WarpImage failed (config %d, spans %d)\n", config, spans);
+				return false;
+			}
+			all.insert(all.end(), dst.begin(), dst.end());
+		}
+	}
+	return WriteOutput("warp_fixed.raw", all);
+}
+
+// Catmull-Rom weight of tap i (0..3) at fraction t, as tex2D_bicubic in unwarp.shader
+static double CatmullRom(int i, double t) {
+	const double t2 = t * t, t3 = t2 * t;
+	switch (i) {
+	case 0: return -0.5 * t3 + t2 - 0.5 * t;
+	case 1: return 1.5 * t3 - 2.5 * t2 + 1.0;
+	case 2: return -1.5 * t3 + 2.0 * t2 + 0.5 * t;
+	default: return 0.5 * t3 - 0.5 * t2;
+	}
+}
+
+// WARP_FILTER_BICUBIC against a double-precision Catmull-Rom evaluation of the shader's
+// mapping (clamped UV, clamped taps): every channel within rounding of the reference.
+static bool TestBicubicMatchesReference() {
+	const int srcW = 240, srcH = 180, dstW = 131, dstH = 77;
+	std::vector<unsigned char> src(srcW * srcH * 4);
+	FillPattern(src, 4);
+
+	Float2 page[4] = { { 40, 25 }, { 190, 32 }, { 206, 160 }, { 25, 150 } };
+	Float4x4 unwarp;
+	ComputeTransformMatrix((float)srcW, (float)srcH, page, &unwarp);
+	Float4x4 rotate = {};
+	rotate.c0y = 1.0f; rotate.c1x = -1.0f; rotate.c2z = 1.0f; rotate.c3x = 1.0f; rotate.c3w = 1.0f;
+
+	std::vector<unsigned char> dst(dstW * dstH * 4);
+	for (int config = 0; config < 2; config++) {
+		const Float4x4* display = config ? &rotate : nullptr;
+		if (!WarpImage(src.data(), srcW, srcH, 0, dst.data(), dstW, dstH, 0, &unwarp,
+			(Float4x4*)display, 1, 0.0f)) {
+			printf("  WarpImage failed (config %d)\n", config);
+			return false;
+		}
+		double maxDiff = 0.0;
+		for (int py = 0; py < dstH; py++) {
+			for (int px = 0; px < dstW; px++) {
+				// 1. Output UV -> camera UV -> texture UV
+				const double u = (px + 0.5) / dstW, v = (py + 0.5) / dstH;
+				const double hx = unwarp.c0x * u + unwarp.c1x * v + unwarp.c2x;
+				const double hy = unwarp.c0y * u + unwarp.c1y * v + unwarp.c2y;
+				const double hw = unwarp.c0z * u + unwarp.c1z * v + unwarp.c2z;
+				double tx = hx / hw, ty = hy / hw;
+				if (display) {
+					const double sx = tx, sy = ty;
+					tx = display->c0x * sx + display->c1x * sy + display->c3x;
+					ty = display->c0y * sx + display->c1y * sy + display->c3y;
+				}
+				tx = fmin(fmax(tx, 0.0), 1.0);
+				ty = fmin(fmax(ty, 0.0), 1.0);
+
+				// 2. 4x4 Catmull-Rom around floor(texel), taps clamped to the image
+				const double fx = tx * srcW - 0.5, fy = ty * srcH - 0.5;
+				const int ix = (int)floor(fx) - 1, iy = (int)floor(fy) - 1;
+				const double ax = fx - floor(fx), ay = fy - floor(fy);
+				for (int c = 0; c < 4; c++) {
+					double acc = 0.0;
+					for (int r = 0; r < 4; r++) {
+						const int sy = std::min(std::max(iy + r, 0), srcH - 1);
+						for (int k = 0; k < 4; k++) {
+							const int sx = std::min(std::max(ix + k, 0), srcW - 1);
+							acc += CatmullRom(r, ay) * CatmullRom(k, ax) * src[(sy * srcW + sx) * 4 + c];
+						}
+					}
+					const double diff = fabs(fmin(fmax(acc, 0.0), 255.0) - dst[(py * dstW + px) * 4 + c]);
+					if (diff > maxDiff) maxDiff = diff;
+				}
+			}
+		}
+		if (maxDiff > 1.5) {
+			printf("  config %d: %.3f levels from the reference\n", config, maxDiff);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Correspondences that the homography maps behind the horizon reproject exactly (p / w = d
+// with w < 0), yet they must never be inliers: the hypothesis scoring rejects them, and the
+// refit set, the returned mask and the inlier count must agree with it.
+static bool TestRobustRejectsBehindHorizon() {
+	// w = 1 - 1.5 x: scattered points, kept clear of the horizon itself (|w| >= 0.1)
+	const int count = 40;
+	Float2 src[count], dst[count];
+	int front = 0;
+	unsigned int seed = 5;
+	for (int i = 0; i < count; i++) {
+		float x, y, w;
+		do {
+			seed = seed * 1664525u + 1013904223u;
+			x = (seed >> 8) / 16777216.0f;
+			seed = seed * 1664525u + 1013904223u;
+			y = (seed >> 8) / 16777216.0f;
+			w = 1.0f - 1.5f * x;
+		} while (fabsf(w) < 0.1f);
+		src[i].x = x; src[i].y = y;
+		dst[i].x = x / w; dst[i].y = y / w;
+		if (w > 0.0f) front++;
+	}
+
+	void* est = CreateHomographyEstimator(count);
+	Float4x4 result;
+	unsigned char mask[count];
+	RobustFit fit;
+	const bool ok = EstimateHomographyRobust(est, src, dst, nullptr, count, 0.01f, 0.0f, 0, 0.0f, &result, mask, &fit);
+	DestroyHomographyEstimator(est);
+	if (!ok) {
+		printf("  EstimateHomographyRobust failed\n");
+		return false;
+	}
+
+	int masked = 0;
+	for (int i = 0; i < count; i++) {
+		masked += mask[i];
+		if (mask[i] && 1.0f - 1.5f * src[i].x <= 0.0f) {
+			printf("  point (%.1f, %.1f) behind the horizon is marked as an inlier\n", src[i].x, src[i].y);
+			return false;
+		}
+	}
+	if (masked != front || fit.inlierCount != front) {
+		printf("  %d points masked, %d inliers reported, %d expected\n", masked, fit.inlierCount, front);
+		return false;
+	}
+	return true;
+}
+
+// Invalid arguments return false instead of writing through a null output
+static bool TestRobustRejectsNullResult() {
+	Float2 pts[4] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+	void* est = CreateHomographyEstimator(4);
+	const bool ok = EstimateHomographyRobust(est, pts, pts, nullptr, 4, 0.01f, 0.0f, 0, 0.0f, nullptr, nullptr, nullptr);
+	DestroyHomographyEstimator(est);
+	if (ok) printf("  succeeded without a result matrix\n");
+	return !ok;
+}
+
+// Null matrices are rejected before the initial estimate is copied to the result
+static bool TestRefineRejectsNullMatrices() {
+	std::vector<unsigned char> image(32 * 32 * 4, 128);
+	Float4x4 m = {};
+	m.c0x = 1.0f; m.c1y = 1.0f; m.c2z = 1.0f; m.c3w = 1.0f;
+	if (RefineTransformMatrix(nullptr, image.data(), 32, 32, nullptr, 0, &m, nullptr) ||
+		RefineTransformMatrix(nullptr, image.data(), 32, 32, &m, 0, nullptr, nullptr)) {
+		printf("  succeeded without an initial or a result matrix\n");
+		return false;
+	}
+	return true;
+}
+
+// The separable distance transform is exact: every pixel holds the Euclidean distance to the
+// nearest outline pixel, found by brute force here. Covers two column strips (the second one
+// partial), a 1-pixel-wide page, and a page without outlines, where every pixel keeps the
+// 'far' sentinel width + height.
+static bool TestDistanceFieldMatchesBruteForce() {
+	struct Case { int width, height; float density; };
+	const Case cases[] = { { 300, 23, 0.02f }, { 1, 40, 0.1f }, { 29, 17, 0.0f }, { 1, 9, 0.0f } };
+	for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+		const int w = cases[c].width, h = cases[c].height;
+		std::vector<unsigned char> mask = RandomOutlines(w, h, cases[c].density, 3 + (unsigned int)c);
+		if (!PrepareOutlines("distance", mask, w, h)) return false;
+		std::vector<unsigned char> lineMask(mask.size());
+		std::vector<float> distance(mask.size());
+		int gw = 0, gh = 0;
+		GetReferenceDistanceField("distance", lineMask.data(), distance.data(), &gw, &gh);
+		ReleaseReference("distance");
+		if (gw != w || gh != h) {
+			printf("  %dx%d page reported as %dx%d\n", w, h, gw, gh);
+			return false;
+		}
+
+		for (int y = 0; y < h; y++) {
+			for (int x = 0; x < w; x++) {
+				const size_t i = (size_t)y * w + x;
+				if ((lineMask[i] != 0) != (mask[i] != 0)) {
+					printf("  %dx%d: outline mask differs at (%d, %d)\n", w, h, x, y);
+					return false;
+				}
+				long long best = -1;
+				for (int qy = 0; qy < h; qy++) {
+					for (int qx = 0; qx < w; qx++) {
+						if (!mask[(size_t)qy * w + qx]) continue;
+						const long long d = (long long)(qx - x) * (qx - x) + (long long)(qy - y) * (qy - y);
+						if (best < 0 || d < best) best = d;
+					}
+				}
+				const float expected = best < 0 ? (float)(w + h) : sqrtf((float)best);
+				if (distance[i] != expected) {
+					printf("  %dx%d: distance at (%d, %d) is %g, expected %g\n", w, h, x, y, distance[i], expected);
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+// Region labels match a serial 4-connected flood fill, numbered in raster order of each
+// region's first pixel, with the same bounds and areas. Heights are not multiples of the
+// 64-row union-find bands, so regions cross band seams and the last band is partial.
+static bool TestRegionsMatchFloodFill() {
+	struct Case { int width, height; float density; };
+	const Case cases[] = { { 41, 65, 0.3f }, { 7, 129, 0.45f }, { 96, 200, 0.4f }, { 13, 130, 0.0f } };
+	for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+		const int w = cases[c].width, h = cases[c].height;
+		std::vector<unsigned char> mask = RandomOutlines(w, h, cases[c].density, 17 + (unsigned int)c);
+		if (!PrepareOutlines("regions", mask, w, h)) return false;
+
+		// 1. Serial flood fill
+		std::vector<int> expected(mask.size(), 0), stack, bounds, areas;
+		int count = 0;
+		for (int start = 0; start < w * h; start++) {
+			if (mask[start] || expected[start]) continue;
+			int x0 = w, y0 = h, x1 = 0, y1 = 0, area = 0;
+			expected[start] = ++count;
+			stack.assign(1, start);
+			while (!stack.empty()) {
+				const int p = stack.back(), x = p % w, y = p / w;
+				stack.pop_back();
+				x0 = std::min(x0, x); y0 = std::min(y0, y); x1 = std::max(x1, x + 1); y1 = std::max(y1, y + 1);
+				area++;
+				const int next[4] = { x > 0 ? p - 1 : -1, x + 1 < w ? p + 1 : -1, y > 0 ? p - w : -1, y + 1 < h ? p + w : -1 };
+				for (int k = 0; k < 4; k++) {
+					if (next[k] < 0 || mask[next[k]] || expected[next[k]]) continue;
+					expected[next[k]] = count;
+					stack.push_back(next[k]);
+				}
+			}
+			const int b[4] = { x0, y0, x1 - x0, y1 - y0 };
+			bounds.insert(bounds.end(), b, b + 4);
+			areas.push_back(area);
+		}
+
+		// 2. Labels from the cache
+		const int got = GetReferenceRegionCount("regions");
+		std::vector<int> regionMap(mask.size()), gotBounds(std::max(got, 0) * 4), gotAreas(std::max(got, 0));
+		if (got == count) GetReferenceRegions("regions", regionMap.data(), gotBounds.data(), gotAreas.data());
+		ReleaseReference("regions");
+		if (got != count) {
+			printf("  %dx%d: %d regions, flood fill finds %d\n", w, h, got, count);
+			return false;
+		}
+		for (size_t i = 0; i < mask.size(); i++) {
+			if (regionMap[i] != expected[i]) {
+				printf("  %dx%d: pixel (%d, %d) labelled %d, expected %d\n", w, h, (int)(i % w), (int)(i / w),
+					regionMap[i], expected[i]);
+				return false;
+			}
+		}
+		if (gotBounds != bounds || gotAreas != areas) {
+			printf("  %dx%d: region bounds or areas differ from the flood fill\n", w, h);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Outline bleed gives every outline pixel the colour of a nearest seed (a pixel mapped off
+// the outlines), checked by brute force. Seeds are coloured with their own coordinates so the
+// test can tell which seed was copied; equally near seeds are all accepted. A band of solid
+// outline rows leaves texture rows without any seed, and the texture is checked both at the
+// reference size and scaled (wider, shorter) against it.
+static bool TestBleedMatchesBruteForce() {
+	const int refW = 61, refH = 47;
+	std::vector<unsigned char> mask = RandomOutlines(refW, refH, 0.15f, 29);
+	for (int y = 19; y < 24; y++) std::fill(mask.begin() + y * refW, mask.begin() + (y + 1) * refW, 1);
+	if (!PrepareOutlines("bleed", mask, refW, refH)) return false;
+
+	const int sizes[2][2] = { { refW, refH }, { 83, 35 } };
+	for (int c = 0; c < 2; c++) {
+		const int w = sizes[c][0], h = sizes[c][1];
+
+		// 1. Seeds: the reference pixel each texture pixel maps to (nearest, by scaling) is not outline
+		std::vector<unsigned char> seed((size_t)w * h), rgba((size_t)w * h * 4, 0);
+		bool emptyRow = false;
+		for (int y = 0; y < h; y++) {
+			const int ry = (int)((2LL * y + 1) * refH / (2LL * h));
+			int seeds = 0;
+			for (int x = 0; x < w; x++) {
+				const int rx = (int)((2LL * x + 1) * refW / (2LL * w));
+				const size_t i = (size_t)y * w + x;
+				seed[i] = !mask[(size_t)ry * refW + rx];
+				seeds += seed[i];
+				if (seed[i]) {
+					rgba[i * 4 + 0] = (unsigned char)x; rgba[i * 4 + 1] = (unsigned char)y;
+					rgba[i * 4 + 2] = 1; rgba[i * 4 + 3] = 255;
+				}
+			}
+			emptyRow |= seeds == 0;
+		}
+		if (!emptyRow) {
+			printf("  %dx%d: no texture row without seeds\n", w, h);
+			return false;
+		}
+		if (!BleedUnderOutlines("bleed", rgba.data(), w, h, 0, -1.0f)) {
+			printf("  %dx%d: BleedUnderOutlines failed\n", w, h);
+			return false;
+		}
+
+		// 2. Every pixel now names a seed, its own or one at the brute-force nearest distance
+		for (int y = 0; y < h; y++) {
+			for (int x = 0; x < w; x++) {
+				const unsigned char* p = &rgba[((size_t)y * w + x) * 4];
+				const int sx = p[0], sy = p[1];
+				if (p[2] != 1 || p[3] != 255 || sx >= w || sy >= h || !seed[(size_t)sy * w + sx] ||
+					(seed[(size_t)y * w + x] && (sx != x || sy != y))) {
+					printf("  %dx%d: pixel (%d, %d) holds no valid seed colour\n", w, h, x, y);
+					return false;
+				}
+				int best = -1;
+				for (int qy = 0; qy < h; qy++) {
+					for (int qx = 0; qx < w; qx++) {
+						if (!seed[(size_t)qy * w + qx]) continue;
+						const int d = (qx - x) * (qx - x) + (qy - y) * (qy - y);
+						if (best < 0 || d < best) best = d;
+					}
+				}
+				const int got = (sx - x) * (sx - x) + (sy - y) * (sy - y);
+				if (got != best) {
+					printf("  %dx%d: pixel (%d, %d) took seed (%d, %d) at squared distance %d, nearest is %d\n",
+						w, h, x, y, sx, sy, got, best);
+					return false;
+				}
+			}
+		}
+	}
+	ReleaseReference("bleed");
+	return true;
+}
+
+struct TestCase {
+	const char* name;
+	bool (*run)();
+};
+
+static const TestCase TESTS[] = {
+	{ "IdentityWarp", TestIdentityWarp },
+	{ "YuvWarpAcrossHorizon", TestYuvWarpAcrossHorizon },
+	{ "FixedWarpOutput", TestFixedWarpOutput },
+	{ "BicubicMatchesReference", TestBicubicMatchesReference },
+	{ "RobustRejectsBehindHorizon", TestRobustRejectsBehindHorizon },
+	{ "RobustRejectsNullResult", TestRobustRejectsNullResult },
+	{ "RefineRejectsNullMatrices", TestRefineRejectsNullMatrices },
+	{ "DistanceFieldMatchesBruteForce", TestDistanceFieldMatchesBruteForce },
+	{ "RegionsMatchFloodFill", TestRegionsMatchFloodFill },
+	{ "BleedMatchesBruteForce", TestBleedMatchesBruteForce },
+};
+
+int main(int argc, char** argv) {
+	s_outputDir = argc > 1 ? argv[1] : ".";
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(TESTS) / sizeof(TESTS[0]); i++) {
+		const bool ok = TESTS[i].run();
+		printf("[%s] %s\n", ok ? "PASS" : "FAIL", TESTS[i].name);
+		if (!ok) failed++;
+	}
+	return failed ? 1 : 0;
+}